@@ -0,0 +1,104 @@
+/**
+ * @module answer.c
+ * @author Enri Miho - 0929003
+ * @brief computing the answer of the mastermind server to a guess
+ * @date 17.10.2026
+ */
+
+#include <string.h>
+#include "answer.h"
+
+int compute_answer(uint16_t req, uint8_t *resp, const uint8_t *secret)
+{
+    int colors_left[COLORS];
+    int guess[COLORS];
+    uint8_t parity_calc, parity_recv;
+    int red, white;
+    int j;
+
+    parity_recv = (req >> 15) & 1;
+
+    /* extract the guess and calculate parity */
+    parity_calc = 0;
+    for (j = 0; j < SLOTS; ++j) {
+        int tmp = req & 0x7;
+        parity_calc ^= tmp ^ (tmp >> 1) ^ (tmp >> 2);
+        guess[j] = tmp;
+        req >>= SHIFT_WIDTH;
+    }
+    parity_calc &= 0x1;
+
+    /* marking red and white */
+    (void) memset(&colors_left[0], 0, sizeof(colors_left));
+    red = white = 0;
+    for (j = 0; j < SLOTS; ++j) {
+        /* mark red */
+        if (guess[j] == secret[j]) {
+            red++;
+        } else {
+            colors_left[secret[j]]++;
+        }
+    }
+    for (j = 0; j < SLOTS; ++j) {
+        /* not marked red */
+        if (guess[j] != secret[j]) {
+            if (colors_left[guess[j]] > 0) {
+                white++;
+                colors_left[guess[j]]--;
+            }
+        }
+    }
+
+    /* build response buffer */
+    resp[0] = red;
+    resp[0] |= (white << SHIFT_WIDTH);
+    if (parity_recv != parity_calc) {
+        resp[0] |= (1 << PARITY_ERR_BIT);
+        return -1;
+    } else {
+        return red;
+    }
+}
+
+void build_answer_table(uint8_t *table, const uint8_t *secret)
+{
+    uint16_t guess;
+
+    for (guess = 0; guess < ANSWER_TABLE_SIZE; ++guess) {
+        uint8_t resp;
+        /* with the parity bit cleared, a parity error means the parity of
+           the guess is 1 */
+        if (compute_answer(guess, &resp, secret) < 0) {
+            resp = (resp & ~(1 << PARITY_ERR_BIT)) | (1 << TABLE_PARITY_BIT);
+        }
+        table[guess] = resp;
+    }
+}
+
+int compute_answer_generic(const uint8_t *guess, const uint8_t *secret,
+    int slots, int colors, int *white)
+{
+    int colors_left[MAX_COLORS];
+    int red = 0;
+    int j;
+
+    (void) memset(&colors_left[0], 0, sizeof(colors_left));
+    *white = 0;
+    for (j = 0; j < slots; ++j) {
+        if (guess[j] >= colors) {
+            return -1;
+        }
+        if (guess[j] == secret[j]) {
+            red++;
+        } else {
+            colors_left[secret[j]]++;
+        }
+    }
+    for (j = 0; j < slots; ++j) {
+        if (guess[j] != secret[j] && colors_left[guess[j]] > 0) {
+            (*white)++;
+            colors_left[guess[j]]--;
+        }
+    }
+    return red;
+}
@@ -0,0 +1,78 @@
+/**
+ * @module answer.h
+ * @author Enri Miho - 0929003
+ * @brief computing the answer of the mastermind server to a guess
+ * @date 17.10.2026
+ */
+
+#ifndef ANSWER_H
+#define ANSWER_H
+
+#include <stdint.h>
+
+#define SLOTS (5)
+#define COLORS (8)
+#define SHIFT_WIDTH (3)
+#define PARITY_ERR_BIT (6)
+
+/* Largest games of the versioned protocol */
+#define MAX_SLOTS (8)
+#define MAX_COLORS (16)
+
+/* Number of possible guesses, i.e. requests without the parity bit */
+#define ANSWER_TABLE_SIZE (1 << 15)
+
+/* Bit of a table entry holding the parity of the guess */
+#define TABLE_PARITY_BIT (7)
+
+/**
+ * @brief Compute answer to request
+ * @param req Client's guess
+ * @param resp Buffer that will be sent to the client
+ * @param secret The server's secret
+ * @return Number of correct matches on success; -1 in case of a parity error
+ */
+int compute_answer(uint16_t req, uint8_t *resp, const uint8_t *secret);
+
+/**
+ * @brief Compute the answer to a guess of any size
+ * @param guess The color of each slot of the guess
+ * @param secret The color of each slot of the secret
+ * @param slots Number of slots, at most MAX_SLOTS
+ * @param colors Number of colors, at most MAX_COLORS
+ * @param white Buffer for the number of right colors in wrong slots
+ * @return Number of right colors in the right slots; -1 if a color of the
+ * guess is out of range
+ */
+int compute_answer_generic(const uint8_t *guess, const uint8_t *secret,
+    int slots, int colors, int *white);
+
+/**
+ * @brief Compute the answers to all guesses for one secret
+ * @param table ANSWER_TABLE_SIZE entries, indexed by the guess; every entry
+ * holds the answer and the parity of the guess in TABLE_PARITY_BIT
+ * @param secret The secret
+ */
+void build_answer_table(uint8_t *table, const uint8_t *secret);
+
+/**
+ * @brief Compute answer to request with a table of build_answer_table
+ * @param table The table of the secret
+ * @param req Client's guess
+ * @param resp Buffer that will be sent to the client
+ * @return Number of correct matches on success; -1 in case of a parity error
+ */
+static inline int lookup_answer(const uint8_t *table, uint16_t req,
+    uint8_t *resp)
+{
+    uint8_t entry = table[req & (ANSWER_TABLE_SIZE - 1)];
+
+    resp[0] = entry & ~(1 << TABLE_PARITY_BIT);
+    if ((entry >> TABLE_PARITY_BIT) != (req >> 15)) {
+        resp[0] |= (1 << PARITY_ERR_BIT);
+        return -1;
+    }
+    return entry & 0x7;
+}
+
+#endif /* ANSWER_H */
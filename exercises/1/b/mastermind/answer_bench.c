@@ -0,0 +1,111 @@
+/**
+ * @module answer_bench.c
+ * @author Enri Miho - 0929003
+ * @brief microbenchmark of compute_answer against the answer table
+ * @date 17.10.2026
+ * @details Checks that the table gives the same answer as compute_answer for every request of some secrets, then
+ * times both on the same stream of random requests and the building of a table.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "answer.h"
+
+/* === Constants === */
+
+#define SECRETS (16)
+#define REQUESTS (1 << 16)
+#define DEFAULT_ROUNDS (200)
+
+/* === Prototypes === */
+
+/**
+ * @brief Returns the time of the monotonic clock
+ * @return The time in seconds
+ */
+static double now(void);
+
+/* === Implementations === */
+
+static double now(void){
+
+	struct timespec time;
+	(void) clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec/1e9;
+}
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the table gives a different answer
+ */
+int main(int argc, char **argv){
+
+	long int rounds = (argc > 1) ? strtol(argv[1], NULL, 10) : DEFAULT_ROUNDS;
+	if(rounds < 1){
+		(void) fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	static uint8_t table[ANSWER_TABLE_SIZE];
+	static uint16_t requests[REQUESTS];
+	uint8_t secret[SLOTS];
+	srand(1);
+
+	//every request, with correct and wrong parity
+	for(int s=0; s<SECRETS; s++){
+		for(int i=0; i<SLOTS; i++){
+			secret[i] = rand() % COLORS;
+		}
+		build_answer_table(table, secret);
+		for(uint32_t request=0; request<=UINT16_MAX; request++){
+			uint8_t expected, actual;
+			int expected_ret = compute_answer(request, &expected, secret);
+			int actual_ret = lookup_answer(table, request, &actual);
+			if(expected != actual || expected_ret != actual_ret){
+				(void) fprintf(stderr, "%s: request 0x%x: 0x%x instead of 0x%x\n", argv[0], request, actual, expected);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	for(int i=0; i<REQUESTS; i++){
+		requests[i] = rand() & UINT16_MAX;
+	}
+
+	//the sums keep the compiler from dropping the calls
+	unsigned long int sum = 0;
+	double start = now();
+	for(long int r=0; r<rounds; r++){
+		for(int i=0; i<REQUESTS; i++){
+			uint8_t resp;
+			sum += compute_answer(requests[i], &resp, secret) + resp;
+		}
+	}
+	double loop = now()-start;
+
+	start = now();
+	for(long int r=0; r<rounds; r++){
+		for(int i=0; i<REQUESTS; i++){
+			uint8_t resp;
+			sum -= lookup_answer(table, requests[i], &resp) + resp;
+		}
+	}
+	double lookup = now()-start;
+
+	start = now();
+	for(int s=0; s<SECRETS; s++){
+		secret[0] = s % COLORS;
+		build_answer_table(table, secret);
+	}
+	double build = (now()-start)/SECRETS;
+
+	double requests_total = (double) rounds*REQUESTS;
+	(void) printf("compute_answer %8.2f ns/request\n", loop/requests_total*1e9);
+	(void) printf("lookup_answer  %8.2f ns/request\n", lookup/requests_total*1e9);
+	(void) printf("build table    %8.2f us/secret (pays off after %.0f requests)\n", build*1e6,
+		build/((loop-lookup)/requests_total));
+	return (sum == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,399 @@
+/**
+ * @module bench.c
+ * @author Enri Miho - 0929003
+ * @brief games/sec benchmark of the mastermind server
+ * @date 17.10.2026
+ * @details Starts ./server_bench, the server built without debug output, with 1, 2, 4, ... up to the given number of
+ * worker threads and keeps the given number of connections busy for some seconds. Every connection plays games of
+ * ROUNDS rounds against the known secret and reconnects after each game, so accepting is measured as well. The load is
+ * spread over one process per online processor.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdarg.h>
+
+/* === Constants === */
+
+#define SLOTS (5)
+#define SHIFT_WIDTH (3)
+#define ROUNDS (5)
+#define SECRET "rgbvw"
+#define DEFAULT_PORT "4711"
+#define DEFAULT_CONNECTIONS (256)
+#define DEFAULT_SECONDS (3)
+#define MAX_EVENTS (64)
+
+/* === Global variables === */
+
+/* Name of the program */
+static const char *progname = "bench";
+
+/* Process id of the running server, -1 if none */
+static pid_t server_pid = -1;
+
+/* === Type definitions === */
+
+struct opts{
+	long int max_workers;
+	long int connections;
+	long int seconds;
+	char *portno;
+};
+
+/* One connection of a load process */
+struct connection{
+	int fd;
+	int round;
+};
+
+/* === Prototypes === */
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param options Struct where parsed arguments are stored
+ */
+static void parse_args(int argc, char **argv, struct opts *options);
+
+/**
+ * @brief Starts the server with the given number of workers and waits until it accepts connections
+ * @param options The parsed arguments
+ * @param workers The number of worker threads of the server
+ */
+static void start_server(struct opts *options, long int workers);
+
+/**
+ * @brief Stops the running server
+ */
+static void stop_server(void);
+
+/**
+ * @brief Connects to the server
+ * @param port The port of the server
+ * @return The socket, -1 if the connection failed
+ */
+static int connect_to_server(int port);
+
+/**
+ * @brief Sends the guess of the given round; the last round guesses the secret
+ * @param connection The connection
+ * @return 0 on success, -1 on error
+ */
+static int send_guess(struct connection *connection);
+
+/**
+ * @brief Plays games on the given number of connections until the time is up
+ * @param port The port of the server
+ * @param connections The number of connections
+ * @param seconds The duration
+ * @return The number of finished games
+ */
+static long int generate_load(int port, long int connections, long int seconds);
+
+/**
+ * @brief Terminate the program
+ * @param exitcode
+ * @param fmt
+ * @details The name of the program, stored in the variable progname is used here
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/* === Implementations === */
+
+static void parse_args(int argc, char **argv, struct opts *options){
+
+	if(argc > 0){
+		progname = argv[0];
+	}
+	long int processors = sysconf(_SC_NPROCESSORS_ONLN);
+	options->max_workers = (processors < 1) ? 1 : processors;
+	options->connections = DEFAULT_CONNECTIONS;
+	options->seconds = DEFAULT_SECONDS;
+	options->portno = DEFAULT_PORT;
+
+	int c;
+	while((c = getopt(argc, argv, "j:c:d:p:")) != -1){
+		char *endptr;
+		long int value = 0;
+		if(c != 'p' && c != '?'){
+			value = strtol(optarg, &endptr, 10);
+			if(endptr == optarg || *endptr != '\0' || value < 1){
+				bail_out(EXIT_FAILURE, "invalid argument of -%c: %s", c, optarg);
+			}
+		}
+		switch(c){
+			case 'j':
+				options->max_workers = value;
+				break;
+			case 'c':
+				options->connections = value;
+				break;
+			case 'd':
+				options->seconds = value;
+				break;
+			case 'p':
+				options->portno = optarg;
+				break;
+			default:
+				bail_out(EXIT_FAILURE, "Usage: %s [-j max-workers] [-c connections] [-d seconds] [-p port]", progname);
+		}
+	}
+	if(optind != argc){
+		bail_out(EXIT_FAILURE, "Usage: %s [-j max-workers] [-c connections] [-d seconds] [-p port]", progname);
+	}
+}
+
+static void start_server(struct opts *options, long int workers){
+
+	char workers_str[32];
+	(void) sprintf(workers_str, "%ld", workers);
+
+	server_pid = fork();
+	if(server_pid == 0){
+		(void) execl("./server_bench", "server_bench", "-j", workers_str, options->portno, SECRET, (char *) NULL);
+		exit(EXIT_FAILURE);
+	}
+	else if(server_pid < 0){
+		bail_out(EXIT_FAILURE, "fork");
+	}
+
+	//wait until the server listens
+	for(int i=0; i<200; i++){
+		int fd = connect_to_server(atoi(options->portno));
+		if(fd >= 0){
+			(void) close(fd);
+			return;
+		}
+		struct timespec delay = {0, 10*1000*1000};
+		(void) nanosleep(&delay, NULL);
+	}
+	bail_out(EXIT_FAILURE, "server does not accept connections");
+}
+
+static void stop_server(void){
+
+	if(server_pid < 0){
+		return;
+	}
+	(void) kill(server_pid, SIGINT);
+	(void) waitpid(server_pid, NULL, 0);
+	server_pid = -1;
+}
+
+static int connect_to_server(int port){
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0){
+		return -1;
+	}
+	struct sockaddr_in sin;
+	(void) memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if(connect(fd, (struct sockaddr *) &sin, sizeof(sin)) < 0){
+		(void) close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int send_guess(struct connection *connection){
+
+	//the secret rgbvw is red, green, beige, violet, white; the other guesses are all beige
+	const uint8_t secret[SLOTS] = {4, 2, 0, 6, 7};
+	uint16_t guess = 0;
+	for(int i=0; i<SLOTS; i++){
+		uint16_t color = (connection->round == ROUNDS) ? secret[i] : 0;
+		guess |= color << (i*SHIFT_WIDTH);
+	}
+	uint16_t parity = 0;
+	for(int i=0; i<15; i++){
+		parity ^= (guess >> i) & 1;
+	}
+	guess |= parity << 15;
+	uint8_t request[2] = {guess & 0xff, guess >> 8};
+	return (send(connection->fd, request, sizeof(request), 0) == sizeof(request)) ? 0 : -1;
+}
+
+static long int generate_load(int port, long int connections, long int seconds){
+
+	struct connection *table = calloc(connections, sizeof(struct connection));
+	int epollfd = epoll_create(MAX_EVENTS);
+	if(table == NULL || epollfd < 0){
+		bail_out(EXIT_FAILURE, "setting up load");
+	}
+
+	struct epoll_event event;
+	(void) memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	for(long int i=0; i<connections; i++){
+		table[i].fd = connect_to_server(port);
+		table[i].round = 1;
+		event.data.ptr = &table[i];
+		if(table[i].fd < 0 || send_guess(&table[i]) < 0 || epoll_ctl(epollfd, EPOLL_CTL_ADD, table[i].fd, &event) < 0){
+			bail_out(EXIT_FAILURE, "connect");
+		}
+	}
+
+	long int games = 0;
+	struct timespec now;
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	time_t end_sec = now.tv_sec+seconds;
+	long end_nsec = now.tv_nsec;
+	while(now.tv_sec < end_sec || (now.tv_sec == end_sec && now.tv_nsec < end_nsec)){
+		struct epoll_event events[MAX_EVENTS];
+		int ready = epoll_wait(epollfd, events, MAX_EVENTS, 100);
+		if(ready < 0){
+			if(errno == EINTR){
+				(void) clock_gettime(CLOCK_MONOTONIC, &now);
+				continue;
+			}
+			bail_out(EXIT_FAILURE, "epoll_wait");
+		}
+		for(int i=0; i<ready; i++){
+			struct connection *connection = events[i].data.ptr;
+			uint8_t response;
+			if(recv(connection->fd, &response, 1, 0) != 1){
+				bail_out(EXIT_FAILURE, "read_from_server");
+			}
+			if(connection->round < ROUNDS){
+				connection->round++;
+			}
+			else{
+				//the game is won, play the next one on a new connection
+				if((response & 7) != SLOTS){
+					bail_out(EXIT_FAILURE, "game not won: 0x%x", response);
+				}
+				games++;
+				//reset instead of closing, so thousands of reconnects do not run out of ports in TIME_WAIT
+				struct linger linger = {1, 0};
+				(void) setsockopt(connection->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+				(void) close(connection->fd);
+				connection->fd = connect_to_server(port);
+				connection->round = 1;
+				event.data.ptr = connection;
+				if(connection->fd < 0 || epoll_ctl(epollfd, EPOLL_CTL_ADD, connection->fd, &event) < 0){
+					bail_out(EXIT_FAILURE, "connect");
+				}
+			}
+			if(send_guess(connection) < 0){
+				bail_out(EXIT_FAILURE, "send_to_server");
+			}
+		}
+		(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	}
+
+	for(long int i=0; i<connections; i++){
+		(void) close(table[i].fd);
+	}
+	(void) close(epollfd);
+	free(table);
+	return games;
+}
+
+static void bail_out(int exitcode, const char *fmt, ...){
+
+	va_list ap;
+
+	(void) fprintf(stderr, "%s: ", progname);
+	if (fmt != NULL) {
+		va_start(ap, fmt);
+		(void) vfprintf(stderr, fmt, ap);
+		va_end(ap);
+	}
+	if (errno != 0) {
+		(void) fprintf(stderr, ": %s", strerror(errno));
+	}
+	(void) fprintf(stderr, "\n");
+
+	stop_server();
+	exit(exitcode);
+}
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE otherwise
+ */
+int main(int argc, char **argv){
+
+	struct opts options;
+	parse_args(argc, argv, &options);
+	long int processors = sysconf(_SC_NPROCESSORS_ONLN);
+	long int loaders = (processors < 1) ? 1 : processors;
+	if(loaders > options.connections){
+		loaders = options.connections;
+	}
+
+	(void) printf("%8s %10s %12s %12s\n", "workers", "games", "games/s", "rounds/s");
+	//the load processes must not print the buffered header again
+	(void) fflush(stdout);
+	for(long int workers=1; ; workers*=2){
+		if(workers > options.max_workers){
+			workers = options.max_workers;
+		}
+		start_server(&options, workers);
+
+		//every load process reports its number of games through the pipe
+		int fd[2];
+		if(pipe(fd) < 0){
+			bail_out(EXIT_FAILURE, "pipe");
+		}
+		for(long int l=0; l<loaders; l++){
+			pid_t pid = fork();
+			if(pid == 0){
+				(void) close(fd[0]);
+				server_pid = -1;
+				long int connections = options.connections/loaders + (l < options.connections%loaders);
+				long int games = generate_load(atoi(options.portno), connections, options.seconds);
+				if(write(fd[1], &games, sizeof(games)) != sizeof(games)){
+					bail_out(EXIT_FAILURE, "write");
+				}
+				exit(EXIT_SUCCESS);
+			}
+			else if(pid < 0){
+				bail_out(EXIT_FAILURE, "fork");
+			}
+		}
+		(void) close(fd[1]);
+		long int total = 0;
+		long int games;
+		long int reports = 0;
+		while(read(fd[0], &games, sizeof(games)) == sizeof(games)){
+			total += games;
+			reports++;
+		}
+		(void) close(fd[0]);
+		for(long int l=0; l<loaders; l++){
+			(void) wait(NULL);
+		}
+		stop_server();
+		if(reports != loaders){
+			bail_out(EXIT_FAILURE, "a load process failed");
+		}
+
+		double rate = (double) total/options.seconds;
+		(void) printf("%8ld %10ld %12.0f %12.0f\n", workers, total, rate, rate*ROUNDS);
+		(void) fflush(stdout);
+		if(workers == options.max_workers){
+			break;
+		}
+	}
+	return EXIT_SUCCESS;
+}
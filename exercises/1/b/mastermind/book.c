@@ -0,0 +1,154 @@
+/**
+ * @module book.c
+ * @author Enri Miho - 0929003
+ * @brief generates the opening book of the solver
+ * @date 17.10.2026
+ * @details Plays the solver against every sequence of answers of the first rounds and writes its guesses to a file,
+ * so the client can look them up instead of searching. The guesses only depend on the answers before, not on the
+ * secret.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include "book.h"
+
+/* === Constants === */
+
+#define DEFAULT_ROUNDS (3)
+#define MAX_ROUNDS (6)
+
+/* === Global Variables === */
+
+/** Name of the program **/
+static const char *progname = "book";
+
+/** The state of the solver before each round, too large for the stack **/
+static struct solver states[MAX_ROUNDS];
+
+/** The nodes of the book **/
+static struct book_node *nodes = NULL;
+static uint32_t nodes_size = 0;
+static uint32_t nodes_capacity = 0;
+
+/* === Prototypes === */
+
+/**
+ * @brief Adds the node of a round and the nodes of all later rounds in the book
+ * @param round The round
+ * @param rounds The number of rounds in the book
+ * @return Index of the node
+ */
+static int32_t add_node(int round, int rounds);
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/* === Implementations === */
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ */
+int main(int argc, char **argv){
+
+	const char *usage = "Usage: %s <book-file> [rounds]";
+	progname = argv[0];
+	if(argc != 2 && argc != 3){
+		bail_out(EXIT_FAILURE, usage, progname);
+	}
+	long int rounds = DEFAULT_ROUNDS;
+	if(argc == 3){
+		char *endptr;
+		rounds = strtol(argv[2], &endptr, 10);
+		if(endptr == argv[2] || *endptr != '\0' || rounds < 1 || rounds > MAX_ROUNDS){
+			bail_out(EXIT_FAILURE, "rounds must be between 1 and %d: %s", MAX_ROUNDS, argv[2]);
+		}
+	}
+
+	solver_init(&states[0]);
+	(void) add_node(1, rounds);
+
+	struct book_header header;
+	(void) memset(&header, 0, sizeof(header));
+	(void) strcpy(header.magic, BOOK_MAGIC);
+	header.slots = SLOTS;
+	header.colors = COLORS;
+	header.rounds = rounds;
+	header.nodes = nodes_size;
+
+	FILE *file = fopen(argv[1], "wb");
+	if(file == NULL){
+		bail_out(EXIT_FAILURE, "fopen %s", argv[1]);
+	}
+	if(fwrite(&header, sizeof(header), 1, file) != 1 ||
+		fwrite(nodes, sizeof(struct book_node), nodes_size, file) != nodes_size || fclose(file) != 0){
+		(void) remove(argv[1]);
+		bail_out(EXIT_FAILURE, "writing %s", argv[1]);
+	}
+	(void) printf("%s: %u guesses of %ld rounds\n", argv[1], nodes_size, rounds);
+	free(nodes);
+	return EXIT_SUCCESS;
+}
+
+static int32_t add_node(int round, int rounds){
+
+	if(nodes_size == nodes_capacity){
+		nodes_capacity = (nodes_capacity == 0) ? 64 : 2*nodes_capacity;
+		struct book_node *grown = realloc(nodes, nodes_capacity*sizeof(struct book_node));
+		if(grown == NULL){
+			bail_out(EXIT_FAILURE, "realloc");
+		}
+		nodes = grown;
+	}
+	int32_t index = nodes_size++;
+	struct solver *state = &states[round-1];
+	uint16_t guess = solver_guess(state);
+	nodes[index].guess = guess;
+	nodes[index].round = round;
+	(void) memset(nodes[index].children, 0, sizeof(nodes[index].children));
+	if(round == rounds){
+		return index;
+	}
+
+	//every answer which leaves candidates gets the guess of the next round
+	for(int answer=0; answer<ANSWERS; answer++){
+		if(answer == ANSWER_WON){
+			continue;
+		}
+		(void) memcpy(&states[round], state, sizeof(struct solver));
+		if(solver_answer(&states[round], guess, answer) > 0){
+			int32_t child = add_node(round+1, rounds);
+			//nodes may have moved
+			nodes[index].children[answer] = child;
+		}
+	}
+	return index;
+}
+
+static void bail_out(int exitcode, const char *fmt, ...){
+
+	va_list ap;
+
+	(void) fprintf(stderr, "%s: ", progname);
+	if (fmt != NULL) {
+		va_start(ap, fmt);
+		(void) vfprintf(stderr, fmt, ap);
+		va_end(ap);
+	}
+	if (errno != 0) {
+		(void) fprintf(stderr, ": %s", strerror(errno));
+	}
+	(void) fprintf(stderr, "\n");
+
+	exit(exitcode);
+}
@@ -0,0 +1,36 @@
+/**
+ * @module book.h
+ * @author Enri Miho - 0929003
+ * @brief file format of the opening book of the solver
+ * @date 17.10.2026
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdint.h>
+#include "solver.h"
+
+/* Identifies an opening book, including the version of the format */
+#define BOOK_MAGIC "MMBOOK1"
+
+/* The file the client maps if no other one is given */
+#define DEFAULT_BOOK "opening.book"
+
+/* The header at the start of the file, followed by the nodes */
+struct book_header {
+    char magic[8];                 /* BOOK_MAGIC */
+    uint32_t slots;                /* SLOTS of the solver */
+    uint32_t colors;               /* COLORS of the solver */
+    uint32_t rounds;               /* number of rounds in the book */
+    uint32_t nodes;                /* number of nodes */
+};
+
+/* The guess after a sequence of answers; node 0 is the first guess */
+struct book_node {
+    uint16_t guess;
+    uint16_t round;                /* the round of the guess */
+    int32_t children[ANSWERS];     /* node after each answer, 0 if none */
+};
+
+#endif /* BOOK_H */
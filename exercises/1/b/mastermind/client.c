@@ -11,22 +11,33 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <time.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdarg.h>
+#include "solver.h"
+#include "book.h"
+#include "protocol.h"
 
 /* === Constants === */
 
-#define SLOTS (5)
 #define READ_BYTES (1)
 #define WRITE_BYTES (2)
-#define PARITY_ERR_BIT (6)
 #define GAME_LOST_ERR_BIT (7)
 #define EXIT_PARITY_ERROR (2)
 #define EXIT_GAME_LOST (3)
 #define EXIT_MULTIPLE_ERRORS (4)
+#define MAX_TRIES (35)
+#define DEFAULT_CONNECTIONS (1)
+#define DEFAULT_SECONDS (10)
+#define MAX_EVENTS (64)
+#define INITIAL_NODES (1024)
+#define INITIAL_SAMPLES (4096)
 
 /* === Global variables === */
 
@@ -36,11 +47,63 @@ static const char *progname = "client";
 /*File descriptor for client socket*/
 static int sockfd = -1;
 
+/* The candidates of the secret, too large for the stack */
+static struct solver solver;
+
+/* The mapped opening book, NULL if none */
+static const struct book_node *book = NULL;
+static uint32_t book_size = 0;
+static void *book_map = MAP_FAILED;
+static size_t book_length = 0;
+
+/* The tree of guesses of the load mode, the root is the first guess; it starts as a copy of the book */
+static struct book_node *tree = NULL;
+static int tree_size = 0;
+static int tree_capacity = 0;
+
+/* Runs of the solver in the load mode and the time they took in nanoseconds */
+static long int solver_runs = 0;
+static long long int solver_ns = 0;
+
 /* === Type definitions === */
 
 struct opts{
 	char *server_hostname;
 	char *server_portno;
+	long int connections; //number of concurrent games in load mode, 0 for a single game
+	long int seconds;     //duration of the load mode
+	char *book;           //path of the opening book
+	int book_required;    //set if the book was given with -b
+	long int slots;       //size of the game; other sizes than SLOTS and COLORS use the versioned protocol
+	long int colors;
+};
+
+/* A game of the versioned protocol */
+struct generic_game{
+	int slots;
+	int colors;
+	int round;
+	int counts[MAX_COLORS];  //number of pegs of each color of the secret
+	int placed[MAX_SLOTS];   //color of each slot of the secret, -1 if not known yet
+	int absent;              //a color missing in the secret, -1 if there is none
+};
+
+/* Round trip times of the load mode in nanoseconds */
+struct samples{
+	uint32_t *values;
+	long int size;
+	long int capacity;
+};
+
+/* One connection of the load mode */
+struct connection{
+	int fd;
+	int node;                  //node of the current guess
+	int round;
+	uint16_t guesses[MAX_TRIES];
+	uint8_t answers[MAX_TRIES];
+	struct timespec sent;      //time the current guess was sent, on CLOCK_REALTIME like the receive timestamps
+	long int solver_runs;      //solver runs when the current guess was sent
 };
 
 /* === Prototypes === */
@@ -61,10 +124,158 @@ static void parse_args(int argc, char **argv, struct opts *options);
 static void connect_to_server(struct opts *options);
 
 /**
- * @brief Generates a random 16 bit number, where bit 15 is the parity bit of bits 0-14
- * @return The generated random number
+ * @brief Resolves the address of the server
+ * @param options Struct where parsed arguments are stored
+ * @return The address, to be freed with freeaddrinfo
+ */
+static struct addrinfo *resolve_server(struct opts *options);
+
+/**
+ * @brief Opens a connection to the server
+ * @param server The address of the server
+ * @return The socket, -1 if the connection failed
+ */
+static int open_connection(const struct addrinfo *server);
+
+/**
+ * @brief Plays games on many connections until the time is up and prints the throughput and round trip times
+ * @param options Struct where parsed arguments are stored
+ * @details Every connection plays one game after the other against the random secrets of the server and
+ * reconnects after each game, like bench does. An answer is timed by the kernel when it arrives, so the round trip
+ * does not include the time the client spent on other connections, above all in the solver.
+ */
+static void generate_load(struct opts *options);
+
+/**
+ * @brief Starts the next game of a connection and sends its first guess
+ * @param connection The connection
+ * @param server The address of the server
+ * @param epollfd The epoll instance of the load mode
+ */
+static void start_game(struct connection *connection, const struct addrinfo *server, int epollfd);
+
+/**
+ * @brief Sends the guess of the current node of a connection
+ * @param connection The connection
+ */
+static void send_guess(struct connection *connection);
+
+/**
+ * @brief Receives the answer of the server on a connection of the load mode
+ * @param connection The connection
+ * @param received Set to the time the answer arrived, on CLOCK_REALTIME
+ * @return The answer
+ */
+static uint8_t receive_answer(struct connection *connection, struct timespec *received);
+
+/**
+ * @brief Returns the node after an answer, running the solver if it was not played before
+ * @param connection The connection, whose guesses and answers lead to the node
+ * @return Index of the node
  */
-static uint16_t generate_random_number(void);
+static int next_node(struct connection *connection);
+
+/**
+ * @brief Appends a node to the tree
+ * @param guess The guess of the node
+ * @param round The round of the guess
+ * @return Index of the node
+ */
+static int add_node(uint16_t guess, int round);
+
+/**
+ * @brief Maps the opening book
+ * @param options Struct where parsed arguments are stored
+ * @details The solver guesses the same without the book, so a missing default book is no error.
+ */
+static void load_book(struct opts *options);
+
+/**
+ * @brief Returns the node of the book after an answer
+ * @param node Index of the current node, -1 if the game left the book
+ * @param answer The answer
+ * @return Index of the next node, -1 if it is not in the book
+ */
+static int book_next(int node, uint8_t answer);
+
+/**
+ * @brief Plays a game of any size with the versioned protocol
+ * @param options Struct where parsed arguments are stored
+ * @details The client first asks for the number of pegs of each color with guesses of a single color, then finds
+ * the slots of each color: with a color missing in the secret by splitting the open slots in halves, otherwise by
+ * trying one color after the other in a slot filled up with the most frequent color. It prints the rounds and
+ * terminates like the classic game.
+ */
+static void play_generic(struct opts *options);
+
+/**
+ * @brief Finds the slots of a color with guesses of the color in half of the slots and the missing color elsewhere
+ * @param game The game
+ * @param color The color
+ * @param slots The open slots which hold the color count times
+ * @param size Number of entries of slots
+ * @param count Number of slots holding the color
+ */
+static void locate_color(struct generic_game *game, int color, const int *slots, int size, int count);
+
+/**
+ * @brief Finds the color of a slot with guesses of one color in the slot and the most frequent color elsewhere
+ * @param game The game
+ * @param slot The slot
+ * @param background The most frequent color
+ */
+static void locate_slot(struct generic_game *game, int slot, int background);
+
+/**
+ * @brief Sends a guess of the versioned protocol and receives the answer
+ * @param game The game
+ * @param guess The color of each slot
+ * @return The number of right colors in the right slots
+ * @details Terminates the program if the game is won or lost.
+ */
+static int ask(struct generic_game *game, const uint8_t *guess);
+
+/**
+ * @brief Sends a message of the versioned protocol
+ * @param type The type of the message
+ * @param payload The payload
+ * @param length The length of the payload
+ */
+static void send_message(uint8_t type, const uint8_t *payload, uint8_t length);
+
+/**
+ * @brief Receives a message of the versioned protocol
+ * @param payload Buffer for the payload, at least MAX_PAYLOAD bytes
+ * @param length Buffer for the length of the payload
+ * @return The type of the message
+ */
+static uint8_t receive_message(uint8_t *payload, uint8_t *length);
+
+/**
+ * @brief Receives exactly the given number of bytes
+ * @param buffer Buffer for the bytes
+ * @param length The number of bytes
+ */
+static void receive_all(uint8_t *buffer, size_t length);
+
+/**
+ * @brief Adds a round trip time
+ * @param samples The round trip times
+ * @param ns The round trip time in nanoseconds
+ */
+static void add_sample(struct samples *samples, uint32_t ns);
+
+/**
+ * @brief Prints the percentiles of round trip times and frees them
+ * @param label The name of the round trip times
+ * @param samples The round trip times
+ */
+static void print_samples(const char *label, struct samples *samples);
+
+/**
+ * @brief Compares two round trip times for qsort
+ */
+static int compare_samples(const void *a, const void *b);
 
 /**
  * @brief Terminate the program
@@ -83,26 +294,85 @@ static void free_resources(void);
 
 static void parse_args(int argc, char **argv, struct opts *options){
 	
+	const char *usage = "Usage: %s [-c connections] [-d seconds] [-b book] [-s slots] [-k colors] "
+		"<server-hostname> <server-port>";
 	if(argc > 0) {
         progname = argv[0];
     }
+	options->connections = 0;
+	options->seconds = 0;
+	options->book = DEFAULT_BOOK;
+	options->book_required = 0;
+	options->slots = SLOTS;
+	options->colors = COLORS;
 	
-	if(argc != 3){
-		bail_out(EXIT_FAILURE, "Usage: %s <server-hostname> <server-port>", progname);
+	int c;
+	while((c = getopt(argc, argv, "c:d:b:s:k:")) != -1){
+		char *endptr;
+		long int value = 0;
+		if(c != '?' && c != 'b'){
+			value = strtol(optarg, &endptr, 10);
+			if(endptr == optarg || *endptr != '\0' || value < 1){
+				bail_out(EXIT_FAILURE, "invalid argument of -%c: %s", c, optarg);
+			}
+		}
+		switch(c){
+			case 'c':
+				options->connections = value;
+				break;
+			case 'd':
+				options->seconds = value;
+				break;
+			case 's':
+				if(value > MAX_SLOTS){
+					bail_out(EXIT_FAILURE, "at most %d slots", MAX_SLOTS);
+				}
+				options->slots = value;
+				break;
+			case 'k':
+				if(value > MAX_COLORS){
+					bail_out(EXIT_FAILURE, "at most %d colors", MAX_COLORS);
+				}
+				options->colors = value;
+				break;
+			case 'b':
+				options->book = optarg;
+				options->book_required = 1;
+				break;
+			default:
+				bail_out(EXIT_FAILURE, usage, progname);
+		}
+	}
+	if(argc-optind != 2){
+		bail_out(EXIT_FAILURE, usage, progname);
+	}
+	//either option selects the load mode
+	if(options->connections > 0 || options->seconds > 0){
+		if(options->connections == 0){
+			options->connections = DEFAULT_CONNECTIONS;
+		}
+		if(options->seconds == 0){
+			options->seconds = DEFAULT_SECONDS;
+		}
+		if(options->slots != SLOTS || options->colors != COLORS){
+			bail_out(EXIT_FAILURE, "the load mode plays the classic game of %d slots and %d colors only", SLOTS,
+				COLORS);
+		}
 	}
 	
 	//parse server hostname and port
-	options->server_hostname = argv[1];
-	options->server_portno = argv[2];
+	char *port_arg = argv[optind+1];
+	options->server_hostname = argv[optind];
+	options->server_portno = port_arg;
 	
 	//verify the port
 	char *endptr;
 	errno = 0;
-	long int port = strtol(argv[2],&endptr,10);
+	long int port = strtol(port_arg,&endptr,10);
 	if(errno == ERANGE || errno !=0){
 		bail_out(EXIT_FAILURE, "strtol");
 	}
-	if(endptr == argv[2]){
+	if(endptr == port_arg){
 		bail_out(EXIT_FAILURE, "port has no digits");
 	}
 	if (*endptr != '\0') {
@@ -115,10 +385,15 @@ static void parse_args(int argc, char **argv, struct opts *options){
 
 static void connect_to_server(struct opts *options){
 	
-	sockfd = socket(AF_INET, SOCK_STREAM, 0);
-	if (sockfd < 0) {
-		bail_out(EXIT_FAILURE, "socket");
-    }
+	struct addrinfo *server = resolve_server(options);
+	sockfd = open_connection(server);
+	if(sockfd < 0){
+		bail_out(EXIT_FAILURE, "connect");
+	}
+	freeaddrinfo(server); /* No longer needed */
+}
+
+static struct addrinfo *resolve_server(struct opts *options){
 	
 	struct addrinfo hints;
 	(void) memset(&hints, 0, sizeof(struct addrinfo));
@@ -132,22 +407,527 @@ static void connect_to_server(struct opts *options){
 		bail_out(EXIT_FAILURE, "getaddrinfo: %s\n", gai_strerror(s));
     }
 	errno = 0; //workaround, for some reason errno is set here to ENOENT when using localhost
-	if(connect(sockfd, server->ai_addr, server->ai_addrlen)<0){
+	return server;
+}
+
+static int open_connection(const struct addrinfo *server){
+	
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		bail_out(EXIT_FAILURE, "socket");
+    }
+	if(connect(fd, server->ai_addr, server->ai_addrlen)<0){
+		(void) close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void generate_load(struct opts *options){
+	
+	struct addrinfo *server = resolve_server(options);
+	struct connection *table = calloc(options->connections, sizeof(struct connection));
+	int epollfd = epoll_create(MAX_EVENTS);
+	if(table == NULL || epollfd < 0){
+		bail_out(EXIT_FAILURE, "setting up load");
+	}
+	solver_init(&solver);
+	if(book != NULL){
+		for(uint32_t i=0; i<book_size; i++){
+			(void) add_node(book[i].guess, book[i].round);
+			(void) memcpy(tree[i].children, book[i].children, sizeof(tree[i].children));
+		}
+	}
+	else{
+		(void) add_node(solver_guess(&solver), 1);
+	}
+	
+	struct timespec start, now;
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	for(long int i=0; i<options->connections; i++){
+		table[i].fd = -1;
+		start_game(&table[i], server, epollfd);
+	}
+	
+	long int games = 0;
+	long int rounds = 0;
+	struct samples quiet_samples = {NULL, 0, 0};
+	struct samples solver_samples = {NULL, 0, 0};
+	now = start;
+	time_t end_sec = start.tv_sec+options->seconds;
+	while(now.tv_sec < end_sec || (now.tv_sec == end_sec && now.tv_nsec < start.tv_nsec)){
+		struct epoll_event events[MAX_EVENTS];
+		int ready = epoll_wait(epollfd, events, MAX_EVENTS, 100);
+		if(ready < 0){
+			if(errno == EINTR){
+				errno = 0;
+				(void) clock_gettime(CLOCK_MONOTONIC, &now);
+				continue;
+			}
+			bail_out(EXIT_FAILURE, "epoll_wait");
+		}
+		(void) clock_gettime(CLOCK_MONOTONIC, &now);
+		for(int i=0; i<ready; i++){
+			struct connection *connection = events[i].data.ptr;
+			struct timespec received;
+			uint8_t response = receive_answer(connection, &received);
+			
+			//a solver run while the guess was on its way keeps the server from the processor if they share it
+			uint32_t ns = (received.tv_sec-connection->sent.tv_sec)*1000000000L +
+				(received.tv_nsec-connection->sent.tv_nsec);
+			add_sample((connection->solver_runs == solver_runs) ? &quiet_samples : &solver_samples, ns);
+			rounds++;
+			
+			if((response & ((1 << PARITY_ERR_BIT) | (1 << GAME_LOST_ERR_BIT))) != 0){
+				bail_out(EXIT_FAILURE, "game failed: 0x%x", response);
+			}
+			if((7&response) == SLOTS){
+				//the game is won, play the next one on a new connection
+				games++;
+				start_game(connection, server, epollfd);
+				continue;
+			}
+			connection->answers[connection->round-1] = response;
+			connection->node = next_node(connection);
+			connection->round++;
+			send_guess(connection);
+		}
+	}
+	
+	double seconds = (now.tv_sec-start.tv_sec) + (now.tv_nsec-start.tv_nsec)/1e9;
+	(void) printf("%ld connections, %.1f s: %ld games (%.0f games/s), %ld rounds (%.0f rounds/s)\n",
+		options->connections, seconds, games, games/seconds, rounds, rounds/seconds);
+	print_samples("round trip", &quiet_samples);
+	print_samples("round trip while solving", &solver_samples);
+	//the solver only costs throughput, as the answers which arrive meanwhile are timed by the kernel
+	(void) printf("solver: %d guesses computed in %.1f ms, %u from the book\n", tree_size-(int) book_size,
+		solver_ns/1e6, book_size);
+	
+	for(long int i=0; i<options->connections; i++){
+		(void) close(table[i].fd);
+	}
+	(void) close(epollfd);
+	free(table);
+	freeaddrinfo(server);
+}
+
+static void start_game(struct connection *connection, const struct addrinfo *server, int epollfd){
+	
+	if(connection->fd >= 0){
+		//reset instead of closing, so thousands of reconnects do not run out of ports in TIME_WAIT
+		struct linger linger = {1, 0};
+		(void) setsockopt(connection->fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+		(void) close(connection->fd);
+	}
+	connection->fd = open_connection(server);
+	connection->node = 0;
+	connection->round = 1;
+	
+	struct epoll_event event;
+	(void) memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = connection;
+	int on = 1;
+	if(connection->fd < 0 || epoll_ctl(epollfd, EPOLL_CTL_ADD, connection->fd, &event) < 0 ||
+		setsockopt(connection->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0){
 		bail_out(EXIT_FAILURE, "connect");
 	}
-	freeaddrinfo(server); /* No longer needed */
+	send_guess(connection);
 }
 
-static uint16_t generate_random_number(void){ 
+static void send_guess(struct connection *connection){
 	
-	uint16_t random_number = rand() % 32768; // 32767 = 0111111111111111
-	uint16_t one = 1; //0000000000000001 (used for masking) 
-	uint16_t parity = one & random_number; //most right bit
-	for(int i = 1; i<15; i++){
-		parity = ((random_number >> i) & one) ^ parity;
+	uint16_t guess = tree[connection->node].guess;
+	uint16_t request = add_parity(guess);
+	connection->guesses[connection->round-1] = guess;
+	connection->solver_runs = solver_runs;
+	(void) clock_gettime(CLOCK_REALTIME, &connection->sent);
+	if(send(connection->fd, &request, WRITE_BYTES, 0) < WRITE_BYTES){
+		bail_out(EXIT_FAILURE, "send_to_server");
 	}
-	random_number = random_number | (parity << 15);
-	return random_number;
+}
+
+static uint8_t receive_answer(struct connection *connection, struct timespec *received){
+	
+	uint8_t answer;
+	struct iovec iov = {&answer, READ_BYTES};
+	union {
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(struct timespec))];
+	} control;
+	struct msghdr message;
+	(void) memset(&message, 0, sizeof(message));
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+	if(recvmsg(connection->fd, &message, 0) < READ_BYTES){
+		bail_out(EXIT_FAILURE, "read_from_server");
+	}
+	
+	//without a timestamp the answer is timed now
+	(void) clock_gettime(CLOCK_REALTIME, received);
+	for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)){
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS){
+			(void) memcpy(received, CMSG_DATA(cmsg), sizeof(struct timespec));
+		}
+	}
+	return answer;
+}
+
+static int next_node(struct connection *connection){
+	
+	int round = connection->round;
+	uint8_t answer = connection->answers[round-1];
+	int child = tree[connection->node].children[answer];
+	if(child != 0){
+		return child;
+	}
+	
+	//replay the game so far to get its candidates
+	struct timespec start, end;
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	solver_init(&solver);
+	for(int r=0; r<round; r++){
+		if(solver_answer(&solver, connection->guesses[r], connection->answers[r]) == 0){
+			bail_out(EXIT_FAILURE, "No code is consistent with the answers");
+		}
+	}
+	child = add_node(solver_guess(&solver), round+1);
+	tree[connection->node].children[answer] = child;
+	(void) clock_gettime(CLOCK_MONOTONIC, &end);
+	solver_ns += (end.tv_sec-start.tv_sec)*1000000000LL + (end.tv_nsec-start.tv_nsec);
+	solver_runs++;
+	return child;
+}
+
+static int add_node(uint16_t guess, int round){
+	
+	if(tree_size == tree_capacity){
+		tree_capacity = (tree_capacity == 0) ? INITIAL_NODES : 2*tree_capacity;
+		struct book_node *grown = realloc(tree, tree_capacity*sizeof(struct book_node));
+		if(grown == NULL){
+			bail_out(EXIT_FAILURE, "realloc");
+		}
+		tree = grown;
+	}
+	struct book_node *node = &tree[tree_size];
+	node->guess = guess;
+	node->round = round;
+	(void) memset(node->children, 0, sizeof(node->children));
+	return tree_size++;
+}
+
+static void load_book(struct opts *options){
+	
+	int fd = open(options->book, O_RDONLY);
+	if(fd < 0){
+		if(errno == ENOENT && !options->book_required){
+			errno = 0;
+			return;
+		}
+		bail_out(EXIT_FAILURE, "open %s", options->book);
+	}
+	struct stat info;
+	if(fstat(fd, &info) < 0){
+		(void) close(fd);
+		bail_out(EXIT_FAILURE, "fstat %s", options->book);
+	}
+	book_length = info.st_size;
+	if(book_length < sizeof(struct book_header)){
+		(void) close(fd);
+		bail_out(EXIT_FAILURE, "%s is no opening book", options->book);
+	}
+	book_map = mmap(NULL, book_length, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+	if(book_map == MAP_FAILED){
+		bail_out(EXIT_FAILURE, "mmap %s", options->book);
+	}
+	
+	//a book of another format or game would give wrong guesses or point outside of the map
+	const struct book_header *header = book_map;
+	const struct book_node *nodes = (const struct book_node *) (header+1);
+	if(memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 || header->slots != SLOTS ||
+		header->colors != COLORS || header->nodes == 0 ||
+		book_length != sizeof(struct book_header) + (size_t) header->nodes*sizeof(struct book_node)){
+		bail_out(EXIT_FAILURE, "%s is no opening book of this version", options->book);
+	}
+	for(uint32_t i=0; i<header->nodes; i++){
+		for(int a=0; a<ANSWERS; a++){
+			if(nodes[i].children[a] < 0 || (uint32_t) nodes[i].children[a] >= header->nodes){
+				bail_out(EXIT_FAILURE, "%s is corrupt", options->book);
+			}
+		}
+	}
+	book = nodes;
+	book_size = header->nodes;
+}
+
+static int book_next(int node, uint8_t answer){
+	
+	if(node < 0 || book[node].children[answer] == 0){
+		return -1;
+	}
+	return book[node].children[answer];
+}
+
+static void play_generic(struct opts *options){
+	
+	struct generic_game game;
+	uint8_t payload[MAX_PAYLOAD];
+	uint8_t length;
+	uint8_t guess[MAX_SLOTS];
+	
+	//ask for the size, the server may refuse it
+	payload[0] = options->slots;
+	payload[1] = options->colors;
+	send_message(MSG_HELLO, payload, 2);
+	uint8_t type = receive_message(payload, &length);
+	if(type == MSG_ERROR && length == 1){
+		bail_out(EXIT_FAILURE, "server refused the game: error %d", payload[0]);
+	}
+	if(type != MSG_WELCOME || length != 3 || payload[0] != options->slots || payload[1] != options->colors){
+		bail_out(EXIT_FAILURE, "unexpected message %d from server", type);
+	}
+	game.slots = options->slots;
+	game.colors = options->colors;
+	game.round = 1;
+	game.absent = -1;
+	
+	//the number of pegs of each color, the last one follows from the others
+	int found = 0;
+	for(int c=0; c<game.colors; c++){
+		game.counts[c] = 0;
+		if(found == game.slots){
+			continue;
+		}
+		if(c == game.colors-1){
+			game.counts[c] = game.slots-found;
+			break;
+		}
+		(void) memset(guess, c, game.slots);
+		game.counts[c] = ask(&game, guess);
+		found += game.counts[c];
+	}
+	int background = 0;
+	for(int c=0; c<game.colors; c++){
+		if(game.counts[c] == 0 && game.absent < 0){
+			game.absent = c;
+		}
+		if(game.counts[c] > game.counts[background]){
+			background = c;
+		}
+	}
+	
+	//the slots of each color
+	for(int j=0; j<game.slots; j++){
+		game.placed[j] = -1;
+	}
+	if(game.absent >= 0){
+		for(int c=0; c<game.colors; c++){
+			int open[MAX_SLOTS];
+			int size = 0;
+			for(int j=0; j<game.slots; j++){
+				if(game.placed[j] < 0){
+					open[size++] = j;
+				}
+			}
+			locate_color(&game, c, open, size, game.counts[c]);
+		}
+	}
+	else{
+		for(int j=0; j<game.slots; j++){
+			locate_slot(&game, j, background);
+		}
+	}
+	
+	for(int j=0; j<game.slots; j++){
+		guess[j] = game.placed[j];
+	}
+	(void) ask(&game, guess);
+	bail_out(EXIT_FAILURE, "the answers are inconsistent");
+}
+
+static void locate_color(struct generic_game *game, int color, const int *slots, int size, int count){
+	
+	if(count == 0){
+		return;
+	}
+	if(count == size){
+		for(int i=0; i<size; i++){
+			game->placed[slots[i]] = color;
+		}
+		return;
+	}
+	
+	//the missing color gives no red, so the red pegs are the slots of the color in the first half
+	uint8_t guess[MAX_SLOTS];
+	int half = size/2;
+	(void) memset(guess, game->absent, game->slots);
+	for(int i=0; i<half; i++){
+		guess[slots[i]] = color;
+	}
+	int red = ask(game, guess);
+	locate_color(game, color, slots, half, red);
+	locate_color(game, color, slots+half, size-half, count-red);
+}
+
+static void locate_slot(struct generic_game *game, int slot, int background){
+	
+	int left[MAX_COLORS];
+	int candidates = 0;
+	int last = -1;
+	
+	//the pegs of each color not placed yet
+	for(int c=0; c<game->colors; c++){
+		left[c] = game->counts[c];
+	}
+	for(int j=0; j<game->slots; j++){
+		if(game->placed[j] >= 0){
+			left[game->placed[j]]--;
+		}
+	}
+	for(int c=0; c<game->colors; c++){
+		if(left[c] > 0){
+			candidates++;
+		}
+	}
+	
+	uint8_t guess[MAX_SLOTS];
+	int base = left[background];
+	for(int j=0; j<game->slots; j++){
+		guess[j] = (game->placed[j] >= 0) ? game->placed[j] : background;
+		base += (game->placed[j] >= 0);
+	}
+	//with one more red the color is in the slot, with one less the background color
+	for(int c=0; c<game->colors && candidates > 1; c++){
+		if(c == background || left[c] == 0){
+			continue;
+		}
+		guess[slot] = c;
+		int red = ask(game, guess);
+		if(red == base+1){
+			game->placed[slot] = c;
+			return;
+		}
+		if(red == base-1){
+			game->placed[slot] = background;
+			return;
+		}
+		candidates--;
+		left[c] = 0;
+	}
+	//only one color is left
+	for(int c=0; c<game->colors; c++){
+		if(left[c] > 0){
+			last = c;
+			break;
+		}
+	}
+	game->placed[slot] = last;
+}
+
+static int ask(struct generic_game *game, const uint8_t *guess){
+	
+	uint8_t payload[MAX_PAYLOAD];
+	uint8_t length;
+	
+	send_message(MSG_GUESS, guess, game->slots);
+	uint8_t type = receive_message(payload, &length);
+	if(type != MSG_ANSWER || length != 3){
+		bail_out(EXIT_FAILURE, "unexpected message %d from server", type);
+	}
+	
+	//check the bits
+	uint8_t flags = payload[2];
+	if(((flags & (1 << ANSWER_BAD_GUESS_BIT))>0) && ((flags & (1 << ANSWER_LOST_BIT))>0)){
+		bail_out(EXIT_MULTIPLE_ERRORS,"Bad guess\nGame lost");
+	}
+	if((flags & (1 << ANSWER_BAD_GUESS_BIT))>0){
+		bail_out(EXIT_PARITY_ERROR,"Bad guess");
+	}
+	if((flags & (1 << ANSWER_LOST_BIT))>0){
+		bail_out(EXIT_GAME_LOST,"Game lost");
+	}
+	
+	//check if the client won the game
+	if(payload[0] == game->slots){
+		(void) printf("Runden: %d\n", game->round);
+		free_resources();
+		exit(EXIT_SUCCESS);
+	}
+	game->round++;
+	return payload[0];
+}
+
+static void send_message(uint8_t type, const uint8_t *payload, uint8_t length){
+	
+	uint8_t message[HEADER_BYTES+MAX_PAYLOAD];
+	message[0] = PROTOCOL_MAGIC;
+	message[1] = PROTOCOL_VERSION;
+	message[2] = type;
+	message[3] = length;
+	(void) memcpy(&message[HEADER_BYTES], payload, length);
+	if(send(sockfd, message, HEADER_BYTES+length, 0) < HEADER_BYTES+length){
+		bail_out(EXIT_FAILURE, "send_to_server");
+	}
+}
+
+static uint8_t receive_message(uint8_t *payload, uint8_t *length){
+	
+	uint8_t header[HEADER_BYTES];
+	receive_all(header, HEADER_BYTES);
+	if(header[0] != PROTOCOL_MAGIC || header[1] != PROTOCOL_VERSION || header[3] > MAX_PAYLOAD){
+		bail_out(EXIT_FAILURE, "the server does not speak version %d", PROTOCOL_VERSION);
+	}
+	*length = header[3];
+	receive_all(payload, *length);
+	return header[2];
+}
+
+static void receive_all(uint8_t *buffer, size_t length){
+	
+	size_t received = 0;
+	while(received < length){
+		ssize_t r = recv(sockfd, buffer+received, length-received, 0);
+		if(r <= 0){
+			bail_out(EXIT_FAILURE, "read_from_server");
+		}
+		received += r;
+	}
+}
+
+static void add_sample(struct samples *samples, uint32_t ns){
+	
+	if(samples->size == samples->capacity){
+		samples->capacity = (samples->capacity == 0) ? INITIAL_SAMPLES : 2*samples->capacity;
+		uint32_t *grown = realloc(samples->values, samples->capacity*sizeof(uint32_t));
+		if(grown == NULL){
+			bail_out(EXIT_FAILURE, "realloc");
+		}
+		samples->values = grown;
+	}
+	samples->values[samples->size++] = ns;
+}
+
+static void print_samples(const char *label, struct samples *samples){
+	
+	if(samples->size > 0){
+		long int size = samples->size;
+		qsort(samples->values, size, sizeof(uint32_t), compare_samples);
+		(void) printf("%s: p50 %.1f us, p99 %.1f us, p999 %.1f us (%ld rounds)\n", label,
+			samples->values[size*50/100]/1e3, samples->values[size*99/100]/1e3, samples->values[size*999/1000]/1e3,
+			size);
+	}
+	free(samples->values);
+	(void) memset(samples, 0, sizeof(*samples));
+}
+
+static int compare_samples(const void *a, const void *b){
+	
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
 }
 
 static void bail_out(int exitcode, const char *fmt, ...){
@@ -174,6 +954,10 @@ static void free_resources(void){
     if(sockfd >= 0) {
         (void) close(sockfd);
     }
+    free(tree);
+    if(book_map != MAP_FAILED){
+        (void) munmap(book_map, book_length);
+    }
 }
 
 /**
@@ -188,16 +972,28 @@ int main(int argc, char **argv){
 	
 	struct opts options;
 	parse_args(argc, argv, &options);
+	load_book(&options);
+	if(options.connections > 0){
+		generate_load(&options);
+		free_resources();
+		return EXIT_SUCCESS;
+	}
 	connect_to_server(&options);
-	srand(time(NULL));
+	if(options.slots != SLOTS || options.colors != COLORS){
+		play_generic(&options);
+	}
+	solver_init(&solver);
 	uint8_t response = 0;
 	int round = 1;
+	int node = (book != NULL) ? 0 : -1;
 	
 	while(1){
 		
-		uint16_t random_number = generate_random_number();
+		//the book saves the search of the first rounds
+		uint16_t guess = (node >= 0) ? book[node].guess : solver_guess(&solver);
+		uint16_t request = add_parity(guess);
 		//send guess to the server
-		if(send(sockfd, &random_number, WRITE_BYTES, 0)< WRITE_BYTES){
+		if(send(sockfd, &request, WRITE_BYTES, 0)< WRITE_BYTES){
 			bail_out(EXIT_FAILURE, "send_to_server");
     	}
     	//receive response from the server
@@ -222,6 +1018,11 @@ int main(int argc, char **argv){
 			break;
 		}
 		
+		//keep the codes which would have given the same answer
+		if(solver_answer(&solver, guess, response) == 0){
+			bail_out(EXIT_FAILURE, "No code is consistent with the answers");
+		}
+		node = book_next(node, response);
 		round++;
 	}
 	
@@ -0,0 +1,49 @@
+/**
+ * @module protocol.h
+ * @author Enri Miho - 0929003
+ * @brief the versioned protocol of the mastermind server for games of any
+ * size
+ * @date 17.10.2026
+ *
+ * Every message starts with a header of HEADER_BYTES bytes: PROTOCOL_MAGIC,
+ * PROTOCOL_VERSION, the type and the length of the payload which follows.
+ * The client starts with MSG_HELLO, the server answers with MSG_WELCOME or
+ * MSG_ERROR, then every MSG_GUESS gets a MSG_ANSWER.
+ *
+ * The server switches to this protocol only once a whole header with
+ * PROTOCOL_MAGIC, PROTOCOL_VERSION, a known type and a payload of at most
+ * MAX_PAYLOAD bytes has arrived; any other start of a connection is
+ * answered as classic request. The first two bytes of a header are a
+ * classic request with a wrong parity bit, so only a classic client sending
+ * exactly that request waits for its answer until it sends the next one.
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "answer.h"
+
+#define PROTOCOL_MAGIC ('M')
+#define PROTOCOL_VERSION (2)
+#define HEADER_BYTES (4)
+
+/* Longest payload of any message */
+#define MAX_PAYLOAD (MAX_SLOTS)
+
+/* Types of messages */
+#define MSG_HELLO (1)    /* client: slots, colors */
+#define MSG_WELCOME (2)  /* server: slots, colors, rounds allowed */
+#define MSG_GUESS (3)    /* client: the color of each slot */
+#define MSG_ANSWER (4)   /* server: red, white, flags */
+#define MSG_ERROR (5)    /* server: error code; the connection is closed */
+
+/* Flags of an answer; the bits are those of the classic answer */
+#define ANSWER_BAD_GUESS_BIT (PARITY_ERR_BIT)
+#define ANSWER_LOST_BIT (7)
+
+/* Error codes */
+#define ERROR_VERSION (1)   /* unsupported version */
+#define ERROR_SIZE (2)      /* unsupported number of slots or colors */
+#define ERROR_MESSAGE (3)   /* unexpected or malformed message */
+
+#endif /* PROTOCOL_H */
@@ -14,7 +14,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  *
  * gcc -std=c99 -Wall -g -pedantic -DENDEBUG \
- *      -D_BSD_SOURCE -D_XOPEN_SOURCE=500 -o server server.c
+ *      -D_BSD_SOURCE -D_XOPEN_SOURCE=500 -pthread -o server server.c answer.c
  */
 
 #include <stdio.h>
@@ -23,32 +23,59 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <fcntl.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <pthread.h>
 #include <errno.h>
 #include <limits.h>
+#include "answer.h"
+#include "protocol.h"
 
 
 /* === Constants === */
 
 #define MAX_TRIES (35)
-#define SLOTS (5)
-#define COLORS (8)
 
 #define READ_BYTES (2)
 #define WRITE_BYTES (1)
-#define BUFFER_BYTES (2)
-#define SHIFT_WIDTH (3)
-#define PARITY_ERR_BIT (6)
+/* A client may pipeline the requests of all rounds at once */
+#define BUFFER_BYTES (READ_BYTES * MAX_TRIES)
+
+/* A message of the versioned protocol has at least HEADER_BYTES and its
+   reply at most HEADER_BYTES + 3, so the replies to a buffer fit in */
+#define SEND_BYTES (2 * BUFFER_BYTES)
+
+/* The protocol of a connection */
+#define PROTOCOL_UNKNOWN (0)
+#define PROTOCOL_CLASSIC (1)
 #define GAME_LOST_ERR_BIT (7)
 
 #define EXIT_PARITY_ERROR (2)
 #define EXIT_GAME_LOST (3)
 #define EXIT_MULTIPLE_ERRORS (4)
 
-#define BACKLOG (5)
+#define BACKLOG (SOMAXCONN)
+
+/* Number of events fetched by one call of epoll_wait */
+#define MAX_EVENTS (64)
+
+/* Initial number of entries of the game table */
+#define INITIAL_GAMES (64)
+
+/* Number of latency buckets; bucket i counts service times below 2^i ns.
+   The service time covers the handling of the requests only, which with
+   ENDEBUG includes its debug output, so latencies are measured on a build
+   without it like server_bench */
+#define LATENCY_BUCKETS (32)
+
+/* Size of the statistics sent to the admin socket */
+#define STATS_BYTES (8192)
 
 
 /* === Macros === */
@@ -62,27 +89,112 @@
 /* Length of an array */
 #define COUNT_OF(x) (sizeof(x)/sizeof(x[0]))
 
+/* Counters are written by their worker only and read by the admin socket,
+   so a relaxed load and store suffice and no locked instruction is needed */
+#define STAT_ADD(counter, n) __atomic_store_n(&(counter), \
+    __atomic_load_n(&(counter), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+#define STAT_GET(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/* === Type Definitions === */
+
+struct opts {
+    long int portno;
+    uint8_t secret[SLOTS];
+    int shared_secret;   /* set if all games use secret */
+    int one_game;        /* set if the server exits after the first game */
+    long int workers;    /* number of worker threads */
+    long int tables;     /* number of answer tables cached per worker */
+    const char *admin;   /* path of the admin socket, NULL if none */
+};
+
+/* Counters of a worker since the start of the server */
+struct stats {
+    unsigned long games_started;
+    unsigned long games_won;
+    unsigned long games_lost;
+    unsigned long parity_errors;
+    unsigned long games_aborted;   /* connection closed before the end */
+    unsigned long requests;
+    unsigned long rounds[MAX_TRIES + 2];      /* ended games by rounds, the
+                                                 last for longer games */
+    unsigned long rounds_sum;
+    unsigned long latency[LATENCY_BUCKETS];   /* requests by service time */
+};
+
+/* The answers to all guesses for one secret */
+struct answer_table {
+    uint8_t secret[SLOTS];
+    int valid;                     /* set if answers belong to secret */
+    int users;                     /* number of games using the table */
+    unsigned long last_used;       /* time of the last game start */
+    uint8_t answers[ANSWER_TABLE_SIZE];
+};
+
+/* State of the game on one connection */
+struct game {
+    int fd;                        /* connection socket, -1 if unused */
+    int round;                     /* number of the next round */
+    int protocol;                  /* PROTOCOL_CLASSIC or PROTOCOL_VERSION */
+    int slots;                     /* size of the game, 0 before MSG_HELLO */
+    int colors;
+    int max_tries;                 /* number of rounds allowed */
+    uint8_t secret[MAX_SLOTS];
+    const uint8_t *answers;        /* answer table of secret, NULL if none */
+    struct answer_table *table;    /* cache entry of answers, NULL if none */
+    uint8_t buffer[BUFFER_BYTES];  /* received requests, the last maybe
+                                      partially */
+    size_t received;               /* number of bytes in buffer */
+};
+
+/* A worker thread with its own listening socket, epoll instance and games,
+   so workers never share state */
+struct worker {
+    pthread_t thread;
+    int sockfd;                    /* listening socket */
+    int epollfd;                   /* epoll instance */
+    struct game *games;            /* games indexed by connection socket */
+    int games_size;                /* number of entries of games */
+    unsigned int seed;             /* state of rand_r for random secrets */
+    struct answer_table *tables;   /* answer tables of random secrets */
+    int tables_size;               /* number of entries of tables */
+    unsigned long clock;           /* number of games started */
+    const struct opts *options;
+    int ret;                       /* result of the game with -o */
+    struct stats stats;
+};
+
+
 /* === Global Variables === */
 
 /* Name of the program */
 static const char *progname = "server"; /* default name */
 
-/* File descriptor for server socket */
-static int sockfd = -1;
+/* The workers */
+static struct worker *workers = NULL;
+
+/* Number of entries of workers */
+static int workers_size = 0;
+
+/* Pipe which becomes readable for all workers when the server shuts down */
+static int wakeup[2] = {-1, -1};
+
+/* Listening admin socket, served by the first worker, -1 if none */
+static int adminfd = -1;
+
+/* Path of the admin socket, removed at exit, NULL if none */
+static const char *admin_path = NULL;
 
-/* File descriptor for connection socket */
-static int connfd = -1;
+/* Answer table of the secret given on the command line, read by all workers */
+static uint8_t shared_answers[ANSWER_TABLE_SIZE];
 
 /* This variable is set upon receipt of a signal */
 volatile sig_atomic_t quit = 0;
 
+/* The thread running main, which alone may free the shared state */
+static pthread_t main_thread;
 
-/* === Type Definitions === */
-
-struct opts {
-    long int portno;
-    uint8_t secret[SLOTS];
-};
+/* Set if a worker thread stopped on a fatal error */
+static volatile sig_atomic_t failed = 0;
 
 
 /* === Prototypes === */
@@ -96,28 +208,157 @@ struct opts {
 static void parse_args(int argc, char **argv, struct opts *options);
 
 /**
- * @brief Read message from socket
+ * @brief Create the listening socket and the epoll instance of a worker
+ * @param worker The worker
  *
- * This code *illustrates* one way to deal with partial reads
+ * All listening sockets are bound to the same port with SO_REUSEPORT, so
+ * the kernel distributes the incoming connections among the workers.
+ */
+static void setup_worker(struct worker *worker);
+
+/**
+ * @brief Event loop of a worker
+ * @param arg The worker
+ * @return NULL
+ */
+static void *run_worker(void *arg);
+
+/**
+ * @brief Accept all pending connections and start a game on each of them;
+ * with -o only the first one is accepted
+ * @param worker The worker whose listening socket is ready
+ * @return Number of accepted connections
+ */
+static int accept_clients(struct worker *worker);
+
+/**
+ * @brief Receive from a connection and answer all complete requests
  *
- * @param sockfd_con Socket to read from
- * @param buffer Buffer where read data is stored
- * @param n Size to read
- * @return Pointer to buffer on success, else NULL
+ * A request may arrive in several partial reads, so the received bytes are
+ * kept in the game until both are there. A client may also pipeline several
+ * requests; they are answered in order with one send, up to the one which
+ * ends the game.
+ *
+ * @param worker The worker of the connection
+ * @param game The game of the connection
+ * @return -1 if the game continues; otherwise it ended and EXIT_SUCCESS,
+ * EXIT_FAILURE, EXIT_PARITY_ERROR, EXIT_GAME_LOST or EXIT_MULTIPLE_ERRORS
+ * is returned like by the single game server
+ */
+static int serve_client(struct worker *worker, struct game *game);
+
+/**
+ * @brief Answer one request and advance the round
+ * @param game The game of the connection
+ * @param request The request
+ * @param resp Buffer for the answer
+ * @return -1 if the game continues; otherwise it ended and EXIT_SUCCESS,
+ * EXIT_PARITY_ERROR, EXIT_GAME_LOST or EXIT_MULTIPLE_ERRORS is returned
+ */
+static int answer_request(struct game *game, uint16_t request, uint8_t *resp);
+
+/**
+ * @brief Handle one message of the versioned protocol
+ * @param worker The worker of the connection
+ * @param game The game of the connection
+ * @param message The message, complete
+ * @param reply Buffer for the reply, its length is in the header
+ * @return -1 if the game continues; otherwise it ended like by
+ * answer_request, or with EXIT_FAILURE after an error message
+ */
+static int handle_message(struct worker *worker, struct game *game,
+    const uint8_t *message, uint8_t *reply);
+
+/**
+ * @brief Mark an answer if it loses the game and advance the round
+ * @param game The game
+ * @param correct_guesses Number of right colors in the right slots, -1 in
+ * case of a parity error or a bad guess
+ * @param flags The byte holding PARITY_ERR_BIT and GAME_LOST_ERR_BIT of the
+ * answer
+ * @return -1 if the game continues; otherwise it ended and EXIT_SUCCESS,
+ * EXIT_PARITY_ERROR, EXIT_GAME_LOST or EXIT_MULTIPLE_ERRORS is returned
+ */
+static int end_round(struct game *game, int correct_guesses, uint8_t *flags);
+
+/**
+ * @brief Write a message of the versioned protocol
+ * @param message Buffer for the message
+ * @param type The type
+ * @param payload The payload
+ * @param length The length of the payload
+ */
+static void write_message(uint8_t *message, uint8_t type,
+    const uint8_t *payload, uint8_t length);
+
+/**
+ * @brief Count the result of an ended game
+ * @param stats Counters of the worker
+ * @param game The game
+ * @param result The result returned by serve_client
+ */
+static void count_result(struct stats *stats, const struct game *game,
+    int result);
+
+/**
+ * @brief Create the admin socket
+ * @param path Path of the unix domain socket
+ */
+static void setup_admin(const char *path);
+
+/**
+ * @brief Send the statistics of all workers to every pending admin client
+ *
+ * The statistics are sent as plain text, one counter per line in the
+ * Prometheus exposition format. The counters of the workers are read
+ * while they are running, so they are not a consistent snapshot.
+ */
+static void serve_admin(void);
+
+/**
+ * @brief Format the sum of the statistics of all workers
+ * @param buffer Buffer for the text
+ * @param size Size of buffer
+ * @return Length of the text, at most size - 1
  */
-static uint8_t *read_from_client(int sockfd_con, uint8_t *buffer, size_t n);
+static size_t format_stats(char *buffer, size_t size);
 
 /**
- * @brief Compute answer to request
- * @param req Client's guess
- * @param resp Buffer that will be sent to the client
- * @param secret The server's secret
- * @return Number of correct matches on success; -1 in case of a parity error
+ * @brief Close a connection and free its entry of the game table
+ * @param game The game of the connection
  */
-static int compute_answer(uint16_t req, uint8_t *resp, uint8_t *secret);
+static void end_game(struct game *game);
 
 /**
- * @brief terminate program on program error
+ * @brief Find or build the cached answer table of a random secret
+ *
+ * A table which is not used by any game is replaced when the secret is not
+ * cached yet, the one unused for the longest time first.
+ *
+ * @param worker The worker whose cache is searched
+ * @param secret The secret
+ * @return The table, NULL if all tables are in use
+ */
+static struct answer_table *acquire_table(struct worker *worker,
+    const uint8_t *secret);
+
+/**
+ * @brief Return the number of online processors, at least 1
+ * @return Number of processors
+ */
+static long int online_processors(void);
+
+/**
+ * @brief Set a file descriptor to non-blocking mode
+ * @param fd The file descriptor
+ * @return 0 on success, -1 on error
+ */
+static int set_nonblocking(int fd);
+
+/**
+ * @brief terminate program on program error; in a worker thread only the
+ * thread ends, after it woke up the others and the main thread, which joins
+ * them before it frees the shared state
  * @param exitcode exit code
  * @param fmt format string
  */
@@ -137,75 +378,723 @@ static void free_resources(void);
 
 /* === Implementations === */
 
-static uint8_t *read_from_client(int fd, uint8_t *buffer, size_t n)
+static void setup_worker(struct worker *worker)
 {
-    /* loop, as packet can arrive in several partial reads */
-    size_t bytes_recv = 0;
-    do {
-        ssize_t r;
-        r = recv(fd, buffer + bytes_recv, n - bytes_recv, 0);
-        if (r <= 0) {
-            return NULL;
-        }
-        bytes_recv += r;
-    } while (bytes_recv < n);
-
-    if (bytes_recv < n) {
-        return NULL;
+	/* create the TCP/IP socket */
+    worker->sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	if(worker->sockfd<0){
+		bail_out(EXIT_FAILURE, "socket");
+	}
+	
+	/* set the SO_REUSEADDR and SO_REUSEPORT options for this socket */
+	int value = 1;
+	if(setsockopt(worker->sockfd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value))<0 ||
+		setsockopt(worker->sockfd, SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value))<0){
+		bail_out(EXIT_FAILURE, "setsockopt");
+	}
+	
+	/* bind this socket to localhost:portno */
+	struct sockaddr_in sin;
+	memset(&sin, 0, sizeof sin);
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(worker->options->portno);
+	sin.sin_addr.s_addr = INADDR_ANY;
+	if(bind(worker->sockfd, (struct sockaddr *)&sin, sizeof sin)<0){
+		bail_out(EXIT_FAILURE, "bind");
+	}
+	
+	/* listen */
+	if(listen(worker->sockfd, BACKLOG)<0){
+		bail_out(EXIT_FAILURE, "listen");
+	}
+    if (set_nonblocking(worker->sockfd) < 0) {
+        bail_out(EXIT_FAILURE, "fcntl");
+    }
+
+    /* all sockets of the worker are watched by its epoll instance */
+    worker->epollfd = epoll_create(MAX_EVENTS);
+    if (worker->epollfd < 0) {
+        bail_out(EXIT_FAILURE, "epoll_create");
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof event);
+    event.events = EPOLLIN;
+    event.data.fd = worker->sockfd;
+    if (epoll_ctl(worker->epollfd, EPOLL_CTL_ADD, worker->sockfd, &event) < 0) {
+        bail_out(EXIT_FAILURE, "epoll_ctl");
+    }
+    event.data.fd = wakeup[0];
+    if (epoll_ctl(worker->epollfd, EPOLL_CTL_ADD, wakeup[0], &event) < 0) {
+        bail_out(EXIT_FAILURE, "epoll_ctl");
+    }
+    if (worker == &workers[0] && adminfd >= 0) {
+        event.data.fd = adminfd;
+        if (epoll_ctl(worker->epollfd, EPOLL_CTL_ADD, adminfd, &event) < 0) {
+            bail_out(EXIT_FAILURE, "epoll_ctl");
+        }
+    }
+    worker->games = malloc(INITIAL_GAMES * sizeof(struct game));
+    if (worker->games == NULL) {
+        bail_out(EXIT_FAILURE, "malloc");
+    }
+    worker->games_size = INITIAL_GAMES;
+    for (int i = 0; i < worker->games_size; ++i) {
+        worker->games[i].fd = -1;
     }
-    return buffer;
 }
 
-static int compute_answer(uint16_t req, uint8_t *resp, uint8_t *secret)
+static void *run_worker(void *arg)
 {
-    int colors_left[COLORS];
-    int guess[COLORS];
-    uint8_t parity_calc, parity_recv;
-    int red, white;
-    int j;
-
-    parity_recv = (req >> 15) & 1;
-
-    /* extract the guess and calculate parity */
-    parity_calc = 0;
-    for (j = 0; j < SLOTS; ++j) {
-        int tmp = req & 0x7;
-        parity_calc ^= tmp ^ (tmp >> 1) ^ (tmp >> 2);
-        guess[j] = tmp;
-        req >>= SHIFT_WIDTH;
-    }
-    parity_calc &= 0x1;
-
-    /* marking red and white */
-    (void) memset(&colors_left[0], 0, sizeof(colors_left));
-    red = white = 0;
-    for (j = 0; j < SLOTS; ++j) {
-        /* mark red */
-        if (guess[j] == secret[j]) {
-            red++;
-        } else {
-            colors_left[secret[j]]++;
+    struct worker *worker = arg;
+    const struct opts *options = worker->options;
+    int done = 0;
+
+    worker->ret = EXIT_SUCCESS;
+    while (!quit && !done) {
+        struct epoll_event events[MAX_EVENTS];
+        int ready = epoll_wait(worker->epollfd, events, MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                errno = 0;
+                continue;
+            }
+            bail_out(EXIT_FAILURE, "epoll_wait");
+        }
+
+        for (int i = 0; i < ready && !done; ++i) {
+            if (events[i].data.fd == wakeup[0]) {
+                /* the server shuts down, the byte stays for the others */
+                done = 1;
+                continue;
+            }
+            if (events[i].data.fd == worker->sockfd) {
+                /* with -o only the first connection is served, the others
+                   wait in the backlog like for the single game server */
+                if (accept_clients(worker) > 0 && options->one_game) {
+                    (void) epoll_ctl(worker->epollfd, EPOLL_CTL_DEL,
+                        worker->sockfd, NULL);
+                }
+                continue;
+            }
+            if (events[i].data.fd == adminfd) {
+                serve_admin();
+                continue;
+            }
+
+            struct game *game = &worker->games[events[i].data.fd];
+            if (game->fd < 0) {
+                /* ended earlier in this batch of events */
+                continue;
+            }
+            int result = serve_client(worker, game);
+            if (result < 0) {
+                continue;
+            }
+            count_result(&worker->stats, game, result);
+            if (options->one_game) {
+                if (result == EXIT_PARITY_ERROR ||
+                    result == EXIT_MULTIPLE_ERRORS) {
+                    (void) fprintf(stderr, "Parity error\n");
+                }
+                if (result == EXIT_GAME_LOST ||
+                    result == EXIT_MULTIPLE_ERRORS) {
+                    (void) fprintf(stderr, "Game lost\n");
+                }
+                if (result == EXIT_SUCCESS) {
+                    (void) printf("Runden: %d\n", game->round);
+                }
+                if (result == EXIT_FAILURE) {
+                    bail_out(EXIT_FAILURE, "read_from_client");
+                }
+                worker->ret = result;
+                done = 1;
+            }
+            end_game(game);
         }
     }
-    for (j = 0; j < SLOTS; ++j) {
-        /* not marked red */
-        if (guess[j] != secret[j]) {
-            if (colors_left[guess[j]] > 0) {
-                white++;
-                colors_left[guess[j]]--;
+    return NULL;
+}
+
+static int accept_clients(struct worker *worker)
+{
+    int accepted = 0;
+
+    for (;;) {
+        struct sockaddr_in client;
+        socklen_t addrlen = sizeof(client);
+        int connfd = accept(worker->sockfd, (struct sockaddr *) &client,
+            &addrlen);
+        if (connfd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                errno = 0;
+                return accepted;
+            }
+            if (errno == EINTR || errno == ECONNABORTED) {
+                errno = 0;
+                continue;
+            }
+            bail_out(EXIT_FAILURE, "accept");
+        }
+        if (set_nonblocking(connfd) < 0) {
+            bail_out(EXIT_FAILURE, "fcntl");
+        }
+
+        /* grow the game table until the socket fits; socket numbers are
+           shared by all threads, so every table may need all of them */
+        if (connfd >= worker->games_size) {
+            int size = worker->games_size;
+            while (size <= connfd) {
+                size *= 2;
+            }
+            struct game *grown = realloc(worker->games,
+                size * sizeof(struct game));
+            if (grown == NULL) {
+                (void) close(connfd);
+                bail_out(EXIT_FAILURE, "realloc");
+            }
+            for (int i = worker->games_size; i < size; ++i) {
+                grown[i].fd = -1;
+            }
+            worker->games = grown;
+            worker->games_size = size;
+        }
+
+        const struct opts *options = worker->options;
+        struct game *game = &worker->games[connfd];
+        game->fd = connfd;
+        game->round = 1;
+        game->received = 0;
+        game->protocol = PROTOCOL_UNKNOWN;
+        game->slots = SLOTS;
+        game->colors = COLORS;
+        game->max_tries = MAX_TRIES;
+        for (int i = 0; i < SLOTS; ++i) {
+            game->secret[i] = options->shared_secret
+                ? options->secret[i] : rand_r(&worker->seed) % COLORS;
+        }
+        game->table = NULL;
+        game->answers = NULL;
+        if (options->shared_secret) {
+            game->answers = shared_answers;
+        } else if (worker->tables_size > 0) {
+            game->table = acquire_table(worker, game->secret);
+            if (game->table != NULL) {
+                game->answers = game->table->answers;
+            }
+        }
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof event);
+        event.events = EPOLLIN;
+        event.data.fd = connfd;
+        if (epoll_ctl(worker->epollfd, EPOLL_CTL_ADD, connfd, &event) < 0) {
+            bail_out(EXIT_FAILURE, "epoll_ctl");
+        }
+        DEBUG("Connection %d: new game\n", connfd);
+        STAT_ADD(worker->stats.games_started, 1);
+        accepted++;
+
+        /* with -o the other connections stay in the backlog */
+        if (options->one_game) {
+            return accepted;
+        }
+    }
+}
+
+static int serve_client(struct worker *worker, struct game *game)
+{
+    struct stats *stats = &worker->stats;
+    uint8_t replies[SEND_BYTES];
+    size_t length = 0;
+    size_t answered = 0;
+    size_t used = 0;
+    int ret = -1;
+    struct timespec start, end;
+
+    ssize_t r = recv(game->fd, game->buffer + game->received,
+        BUFFER_BYTES - game->received, 0);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        errno = 0;
+        return -1;
+    }
+    if (r <= 0) {
+        /* the client closed the connection or it broke */
+        DEBUG("Connection %d: closed in round %d\n", game->fd, game->round);
+        errno = 0;
+        return EXIT_FAILURE;
+    }
+    game->received += r;
+    (void) clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* the versioned protocol is only chosen for a complete and valid header,
+       which a classic client sends only as a request with a wrong parity
+       bit; everything else is answered as classic request right away */
+    if (game->protocol == PROTOCOL_UNKNOWN && game->received >= READ_BYTES) {
+        if (game->buffer[0] != PROTOCOL_MAGIC ||
+            game->buffer[1] != PROTOCOL_VERSION) {
+            game->protocol = PROTOCOL_CLASSIC;
+        } else if (game->received >= HEADER_BYTES) {
+            if (game->buffer[2] >= MSG_HELLO && game->buffer[2] <= MSG_ERROR &&
+                game->buffer[3] <= MAX_PAYLOAD) {
+                game->protocol = PROTOCOL_VERSION;
+                game->slots = 0;
+            } else {
+                game->protocol = PROTOCOL_CLASSIC;
             }
         }
     }
 
-    /* build response buffer */
-    resp[0] = red;
-    resp[0] |= (white << SHIFT_WIDTH);
-    if (parity_recv != parity_calc) {
-        resp[0] |= (1 << PARITY_ERR_BIT);
+    /* a game has at most MAX_TRIES rounds and a message at least
+       HEADER_BYTES, so replies cannot overflow */
+    while (ret < 0 && game->protocol == PROTOCOL_CLASSIC &&
+        game->received - used >= READ_BYTES) {
+        uint16_t request = (game->buffer[used + 1] << 8) | game->buffer[used];
+        used += READ_BYTES;
+        ret = answer_request(game, request, &replies[length]);
+        length += WRITE_BYTES;
+        answered++;
+    }
+    while (ret < 0 && game->protocol == PROTOCOL_VERSION &&
+        game->received - used >= HEADER_BYTES) {
+        const uint8_t *message = &game->buffer[used];
+        if (message[3] > MAX_PAYLOAD) {
+            /* it would never fit into the buffer */
+            uint8_t code = ERROR_MESSAGE;
+            write_message(&replies[length], MSG_ERROR, &code, 1);
+            ret = EXIT_FAILURE;
+        } else if (game->received - used < HEADER_BYTES + message[3]) {
+            break;
+        } else {
+            used += HEADER_BYTES + message[3];
+            ret = handle_message(worker, game, message, &replies[length]);
+        }
+        length += HEADER_BYTES + replies[length + 3];
+        answered++;
+    }
+
+    /* every answered request waited for the whole batch */
+    (void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+    /* keep a partial request for the next call */
+    game->received -= used;
+    (void) memmove(game->buffer, game->buffer + used, game->received);
+
+    if (answered == 0) {
         return -1;
+    }
+
+    /* the client waits for the answers before it sends further requests,
+       so the send buffer of the socket always has room for them */
+    if (send(game->fd, replies, length, 0) < (ssize_t) length) {
+        DEBUG("Connection %d: send failed\n", game->fd);
+        errno = 0;
+        return EXIT_FAILURE;
+    }
+
+    unsigned long ns = (end.tv_sec - start.tv_sec) * 1000000000L +
+        (end.tv_nsec - start.tv_nsec);
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && ns >= (1UL << bucket)) {
+        bucket++;
+    }
+    STAT_ADD(stats->latency[bucket], answered);
+    STAT_ADD(stats->requests, answered);
+    return ret;
+}
+
+static int answer_request(struct game *game, uint16_t request, uint8_t *resp)
+{
+    int correct_guesses;
+
+    DEBUG("Connection %d, round %d: Received 0x%x\n", game->fd, game->round,
+        request);
+
+    /* compute answer */
+    if (game->answers != NULL) {
+        correct_guesses = lookup_answer(game->answers, request, resp);
     } else {
-        return red;
+        correct_guesses = compute_answer(request, resp, game->secret);
     }
+
+    DEBUG("Number of correct guesses: %d\n", correct_guesses);
+    return end_round(game, correct_guesses, resp);
+}
+
+static int handle_message(struct worker *worker, struct game *game,
+    const uint8_t *message, uint8_t *reply)
+{
+    const uint8_t *payload = &message[HEADER_BYTES];
+    uint8_t length = message[3];
+    uint8_t code = ERROR_MESSAGE;
+
+    if (message[0] != PROTOCOL_MAGIC || message[1] != PROTOCOL_VERSION) {
+        DEBUG("Connection %d: version %d\n", game->fd, message[1]);
+        code = (message[0] == PROTOCOL_MAGIC) ? ERROR_VERSION : ERROR_MESSAGE;
+        write_message(reply, MSG_ERROR, &code, 1);
+        return EXIT_FAILURE;
+    }
+
+    if (message[2] == MSG_HELLO && game->slots == 0 && length == 2) {
+        int slots = payload[0];
+        int colors = payload[1];
+        if (slots < 1 || slots > MAX_SLOTS || colors < 1 ||
+            colors > MAX_COLORS) {
+            code = ERROR_SIZE;
+            write_message(reply, MSG_ERROR, &code, 1);
+            return EXIT_FAILURE;
+        }
+        /* the classic game keeps its secret and answer table; larger games
+           get one round per slot and color, enough to find the colors and
+           then their places */
+        if (slots != SLOTS || colors != COLORS) {
+            if (game->table != NULL) {
+                game->table->users--;
+                game->table = NULL;
+            }
+            game->answers = NULL;
+            for (int i = 0; i < slots; ++i) {
+                game->secret[i] = rand_r(&worker->seed) % colors;
+            }
+        }
+        game->slots = slots;
+        game->colors = colors;
+        game->max_tries = (slots <= SLOTS && colors <= COLORS)
+            ? MAX_TRIES : slots * colors;
+        DEBUG("Connection %d: %d slots, %d colors\n", game->fd, slots,
+            colors);
+        uint8_t welcome[3] = {slots, colors, game->max_tries};
+        write_message(reply, MSG_WELCOME, welcome, sizeof(welcome));
+        return -1;
+    }
+
+    if (message[2] == MSG_GUESS && game->slots != 0 &&
+        length == game->slots) {
+        uint8_t answer[3] = {0, 0, 0};
+        int correct_guesses;
+        int white = 0;
+        if (game->slots == SLOTS && game->colors == COLORS) {
+            /* the classic game is answered like a classic request */
+            uint16_t request = 0;
+            int bad = 0;
+            for (int j = 0; j < SLOTS; ++j) {
+                bad |= (payload[j] >= COLORS);
+                request |= (payload[j] & (COLORS - 1)) << (j * SHIFT_WIDTH);
+            }
+            request |= (__builtin_popcount(request) & 1) << 15;
+            uint8_t resp;
+            if (game->answers != NULL) {
+                correct_guesses = lookup_answer(game->answers, request, &resp);
+            } else {
+                correct_guesses = compute_answer(request, &resp,
+                    game->secret);
+            }
+            if (bad) {
+                correct_guesses = -1;
+            } else {
+                white = resp >> SHIFT_WIDTH;
+            }
+        } else {
+            correct_guesses = compute_answer_generic(payload, game->secret,
+                game->slots, game->colors, &white);
+        }
+        if (correct_guesses < 0) {
+            answer[2] |= 1 << ANSWER_BAD_GUESS_BIT;
+            white = 0;
+        }
+        answer[0] = (correct_guesses < 0) ? 0 : correct_guesses;
+        answer[1] = white;
+        DEBUG("Connection %d, round %d: %d red, %d white\n", game->fd,
+            game->round, answer[0], answer[1]);
+        int ret = end_round(game, correct_guesses, &answer[2]);
+        write_message(reply, MSG_ANSWER, answer, sizeof(answer));
+        return ret;
+    }
+
+    DEBUG("Connection %d: unexpected message %d\n", game->fd, message[2]);
+    write_message(reply, MSG_ERROR, &code, 1);
+    return EXIT_FAILURE;
+}
+
+static int end_round(struct game *game, int correct_guesses, uint8_t *flags)
+{
+    int error = 0;
+    int ret = EXIT_SUCCESS;
+
+    if (game->round == game->max_tries && correct_guesses != game->slots) {
+        flags[0] |= 1 << GAME_LOST_ERR_BIT;
+    }
+
+    DEBUG("Sending flags 0x%x\n", flags[0]);
+
+    /* now stop the game if its over, or an error occured; the answer is
+       sent nevertheless */
+    if (flags[0] & (1 << PARITY_ERR_BIT)) {
+        DEBUG("Connection %d: Parity error\n", game->fd);
+        error = 1;
+        ret = EXIT_PARITY_ERROR;
+    }
+    if (flags[0] & (1 << GAME_LOST_ERR_BIT)) {
+        DEBUG("Connection %d: Game lost\n", game->fd);
+        error = 1;
+        if (ret == EXIT_PARITY_ERROR) {
+            ret = EXIT_MULTIPLE_ERRORS;
+        } else {
+            ret = EXIT_GAME_LOST;
+        }
+    }
+    if (error) {
+        return ret;
+    } else if (correct_guesses == game->slots) {
+        /* won */
+        DEBUG("Connection %d: won in round %d\n", game->fd, game->round);
+        return EXIT_SUCCESS;
+    }
+    game->round++;
+    return -1;
+}
+
+static void write_message(uint8_t *message, uint8_t type,
+    const uint8_t *payload, uint8_t length)
+{
+    message[0] = PROTOCOL_MAGIC;
+    message[1] = PROTOCOL_VERSION;
+    message[2] = type;
+    message[3] = length;
+    (void) memcpy(&message[HEADER_BYTES], payload, length);
+}
+
+static void count_result(struct stats *stats, const struct game *game,
+    int result)
+{
+    switch (result) {
+    case EXIT_SUCCESS:
+        STAT_ADD(stats->games_won, 1);
+        break;
+    case EXIT_PARITY_ERROR:
+        STAT_ADD(stats->parity_errors, 1);
+        break;
+    case EXIT_GAME_LOST:
+        STAT_ADD(stats->games_lost, 1);
+        break;
+    case EXIT_MULTIPLE_ERRORS:
+        STAT_ADD(stats->parity_errors, 1);
+        STAT_ADD(stats->games_lost, 1);
+        break;
+    default:
+        STAT_ADD(stats->games_aborted, 1);
+        return;
+    }
+    STAT_ADD(stats->rounds[(game->round <= MAX_TRIES)
+        ? game->round : MAX_TRIES + 1], 1);
+    STAT_ADD(stats->rounds_sum, game->round);
+}
+
+static void setup_admin(const char *path)
+{
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        bail_out(EXIT_FAILURE, "Path of the admin socket is too long: %s",
+            path);
+    }
+    adminfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (adminfd < 0) {
+        bail_out(EXIT_FAILURE, "socket");
+    }
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    (void) strcpy(addr.sun_path, path);
+    if (bind(adminfd, (struct sockaddr *) &addr, sizeof addr) < 0) {
+        bail_out(EXIT_FAILURE, "bind %s", path);
+    }
+    admin_path = path;
+    if (listen(adminfd, BACKLOG) < 0) {
+        bail_out(EXIT_FAILURE, "listen");
+    }
+    if (set_nonblocking(adminfd) < 0) {
+        bail_out(EXIT_FAILURE, "fcntl");
+    }
+}
+
+static void serve_admin(void)
+{
+    char buffer[STATS_BYTES];
+
+    for (;;) {
+        int connfd = accept(adminfd, NULL, NULL);
+        if (connfd < 0) {
+            /* a failing admin client must not stop the games */
+            DEBUG("Admin socket: accept failed\n");
+            errno = 0;
+            return;
+        }
+        size_t length = format_stats(buffer, sizeof buffer);
+        if (send(connfd, buffer, length, 0) < (ssize_t) length) {
+            DEBUG("Admin socket: send failed\n");
+            errno = 0;
+        }
+        (void) close(connfd);
+    }
+}
+
+static size_t format_stats(char *buffer, size_t size)
+{
+    struct stats total;
+    size_t length = 0;
+    unsigned long ended = 0;
+    unsigned long cumulative = 0;
+    const struct {
+        const char *name;
+        unsigned long *value;
+    } counters[] = {
+        {"games_started_total", &total.games_started},
+        {"games_won_total", &total.games_won},
+        {"games_lost_total", &total.games_lost},
+        {"parity_errors_total", &total.parity_errors},
+        {"games_aborted_total", &total.games_aborted},
+        {"requests_total", &total.requests},
+    };
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+/* append to buffer, truncating at its end */
+#define APPEND(...) do { \
+        int n = snprintf(buffer + length, size - length, __VA_ARGS__); \
+        if (n > 0) { \
+            length += n; \
+        } \
+        if (length >= size) { \
+            length = size - 1; \
+        } \
+    } while (0)
+
+    memset(&total, 0, sizeof total);
+    for (int w = 0; w < workers_size; ++w) {
+        struct stats *stats = &workers[w].stats;
+        total.games_started += STAT_GET(stats->games_started);
+        total.games_won += STAT_GET(stats->games_won);
+        total.games_lost += STAT_GET(stats->games_lost);
+        total.parity_errors += STAT_GET(stats->parity_errors);
+        total.games_aborted += STAT_GET(stats->games_aborted);
+        total.requests += STAT_GET(stats->requests);
+        for (int i = 0; i < COUNT_OF(total.rounds); ++i) {
+            total.rounds[i] += STAT_GET(stats->rounds[i]);
+        }
+        total.rounds_sum += STAT_GET(stats->rounds_sum);
+        for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+            total.latency[i] += STAT_GET(stats->latency[i]);
+        }
+    }
+
+    for (int i = 0; i < COUNT_OF(counters); ++i) {
+        APPEND("# TYPE mastermind_%s counter\n", counters[i].name);
+        APPEND("mastermind_%s %lu\n", counters[i].name, *counters[i].value);
+    }
+
+    /* games which ended with an answer, by the number of rounds */
+    for (int i = 1; i < COUNT_OF(total.rounds); ++i) {
+        ended += total.rounds[i];
+    }
+    APPEND("# TYPE mastermind_games_active gauge\n");
+    APPEND("mastermind_games_active %lu\n",
+        total.games_started - total.games_aborted - ended);
+    APPEND("# TYPE mastermind_game_rounds histogram\n");
+    for (int i = 1; i <= MAX_TRIES; ++i) {
+        cumulative += total.rounds[i];
+        APPEND("mastermind_game_rounds_bucket{le=\"%d\"} %lu\n", i,
+            cumulative);
+    }
+    APPEND("mastermind_game_rounds_bucket{le=\"+Inf\"} %lu\n", ended);
+    APPEND("mastermind_game_rounds_sum %lu\n", total.rounds_sum);
+    APPEND("mastermind_game_rounds_count %lu\n", ended);
+
+    /* the quantiles are the upper bounds of their power of two buckets */
+    unsigned long requests = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        requests += total.latency[i];
+    }
+    APPEND("# TYPE mastermind_request_latency_ns summary\n");
+    for (int q = 0; q < COUNT_OF(quantiles); ++q) {
+        unsigned long rank = (unsigned long) (quantiles[q] * requests);
+        int i = 0;
+        cumulative = total.latency[0];
+        while (i < LATENCY_BUCKETS - 1 && cumulative <= rank) {
+            i++;
+            cumulative += total.latency[i];
+        }
+        APPEND("mastermind_request_latency_ns{quantile=\"%g\"} %lu\n",
+            quantiles[q], requests > 0 ? 1UL << i : 0);
+    }
+    APPEND("mastermind_request_latency_ns_count %lu\n", requests);
+#undef APPEND
+
+    return length;
+}
+
+static void end_game(struct game *game)
+{
+    uint8_t discard[BUFFER_BYTES];
+
+    /* requests pipelined past the end of the game would make close reset
+       the connection and drop the last answers, so they are discarded */
+    while (recv(game->fd, discard, sizeof(discard), 0) > 0) {
+    }
+    errno = 0;
+
+    /* closing the socket also removes it from the epoll instance */
+    (void) close(game->fd);
+    game->fd = -1;
+    if (game->table != NULL) {
+        game->table->users--;
+        game->table = NULL;
+    }
+}
+
+static struct answer_table *acquire_table(struct worker *worker,
+    const uint8_t *secret)
+{
+    struct answer_table *unused = NULL;
+
+    worker->clock++;
+    for (int i = 0; i < worker->tables_size; ++i) {
+        struct answer_table *table = &worker->tables[i];
+        if (table->valid && memcmp(table->secret, secret, SLOTS) == 0) {
+            table->users++;
+            table->last_used = worker->clock;
+            return table;
+        }
+        if (table->users == 0 &&
+            (unused == NULL || table->last_used < unused->last_used)) {
+            unused = table;
+        }
+    }
+    if (unused == NULL) {
+        return NULL;
+    }
+    DEBUG("Building answer table\n");
+    build_answer_table(unused->answers, secret);
+    (void) memcpy(unused->secret, secret, SLOTS);
+    unused->valid = 1;
+    unused->users = 1;
+    unused->last_used = worker->clock;
+    return unused;
+}
+
+static long int online_processors(void)
+{
+    long int processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors < 1) {
+        processors = 1;
+    }
+    return processors;
+}
+
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
 static void bail_out(int exitcode, const char *fmt, ...)
@@ -223,6 +1112,13 @@ static void bail_out(int exitcode, const char *fmt, ...)
     }
     (void) fprintf(stderr, "\n");
 
+    /* the other workers still use workers and the answer tables */
+    if (!pthread_equal(pthread_self(), main_thread)) {
+        failed = 1;
+        (void) write(wakeup[1], "q", 1);
+        (void) pthread_kill(main_thread, SIGTERM);
+        pthread_exit(NULL);
+    }
     free_resources();
     exit(exitcode);
 }
@@ -231,11 +1127,36 @@ static void free_resources(void)
 {
     /* clean up resources */
     DEBUG("Shutting down server\n");
-    if(connfd >= 0) {
-        (void) close(connfd);
+    for (int w = 0; w < workers_size; ++w) {
+        struct worker *worker = &workers[w];
+        for (int i = 0; i < worker->games_size; ++i) {
+            if (worker->games[i].fd >= 0) {
+                (void) close(worker->games[i].fd);
+            }
+        }
+        free(worker->games);
+        free(worker->tables);
+        if(worker->epollfd >= 0) {
+            (void) close(worker->epollfd);
+        }
+        if(worker->sockfd >= 0) {
+            (void) close(worker->sockfd);
+        }
+    }
+    free(workers);
+    workers = NULL;
+    workers_size = 0;
+    if (adminfd >= 0) {
+        (void) close(adminfd);
+        adminfd = -1;
     }
-    if(sockfd >= 0) {
-        (void) close(sockfd);
+    if (admin_path != NULL) {
+        (void) unlink(admin_path);
+        admin_path = NULL;
+    }
+    if (wakeup[0] >= 0) {
+        (void) close(wakeup[0]);
+        (void) close(wakeup[1]);
     }
 }
 
@@ -248,17 +1169,17 @@ static void signal_handler(int sig)
  * @brief Program entry point
  * @param argc The argument counter
  * @param argv The argument vector
- * @return EXIT_SUCCESS on success, EXIT_PARITY_ERROR in case of an parity
- * error, EXIT_GAME_LOST in case client needed to many guesses,
+ * @return EXIT_SUCCESS on success; with -o EXIT_PARITY_ERROR in case of an
+ * parity error, EXIT_GAME_LOST in case client needed to many guesses,
  * EXIT_MULTIPLE_ERRORS in case multiple errors occured in one round
  */
 int main(int argc, char *argv[])
 {
 
     struct opts options;
-    int round;
     int ret;
 
+    main_thread = pthread_self();
     parse_args(argc, argv, &options);
 
     /* setup signal handlers */
@@ -275,106 +1196,85 @@ int main(int argc, char *argv[])
             bail_out(EXIT_FAILURE, "sigaction");
         }
     }
+    /* a client which disconnects must not terminate the server */
+    (void) signal(SIGPIPE, SIG_IGN);
 
-	/* create the TCP/IP socket */
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-	if(sockfd<0){
-		bail_out(EXIT_FAILURE, "socket");
-	}
-	
-	/* set the SO_REUSEADDR option for this socket */
-	int value = 1;
-	if(setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value))<0){
-		bail_out(EXIT_FAILURE, "setsockopt");
-	}
-	
-	/* bind this socket to localhost:portno */
-	struct sockaddr_in sin;
-	memset(&sin, 0, sizeof sin);
-	sin.sin_family = AF_INET;
-	sin.sin_port = htons(options.portno);
-	sin.sin_addr.s_addr = INADDR_ANY;
-	if(bind(sockfd, (struct sockaddr *)&sin, sizeof sin)<0){
-		bail_out(EXIT_FAILURE, "bind");
-	}
-	
-	/* listen */
-	if(listen(sockfd, BACKLOG)<0){
-		bail_out(EXIT_FAILURE, "listen");
-	}
-	
-	/* wait for new connections */
-	struct sockaddr_in client;
-	socklen_t addrlen = sizeof(client);
-	connfd = accept(sockfd, (struct sockaddr*)&client, &addrlen);
-	if(connfd<0){
-		bail_out(EXIT_FAILURE, "accept");
-	}
+    if (pipe(wakeup) < 0) {
+        bail_out(EXIT_FAILURE, "pipe");
+    }
+    if (options.shared_secret) {
+        build_answer_table(shared_answers, options.secret);
+    }
+    if (options.admin != NULL) {
+        setup_admin(options.admin);
+    }
 
-    /* accepted the connection */
-    ret = EXIT_SUCCESS;
-    for (round = 1; round <= MAX_TRIES && !quit; ++round) {
-        uint16_t request;
-        static uint8_t buffer[BUFFER_BYTES];
-        int correct_guesses;
-        int error = 0;
-
-        /* read from client */
-        if (read_from_client(connfd, &buffer[0], READ_BYTES) == NULL) {
-            if (quit) break; /* caught signal */
-            bail_out(EXIT_FAILURE, "read_from_client");
-        }
-        request = (buffer[1] << 8) | buffer[0];
-        DEBUG("Round %d: Received 0x%x\n", round, request);
-
-        /* compute answer */
-        correct_guesses = compute_answer(request, buffer, options.secret);
-        if (round == MAX_TRIES && correct_guesses != SLOTS) {
-            buffer[0] |= 1 << GAME_LOST_ERR_BIT;
-        }
-		
-		DEBUG("Number of correct guesses: %d\n", correct_guesses);
-        DEBUG("Sending byte 0x%x\n", buffer[0]);
-
-        /* send message to client */
-        if (send(connfd, buffer, WRITE_BYTES, 0) < WRITE_BYTES) {
-			if (quit) break; /* caught signal */
-            bail_out(EXIT_FAILURE, "send_to_client");
-        }
-
-        /* We sent the answer to the client; now stop the game
-           if its over, or an error occured */
-        if (*buffer & (1<<PARITY_ERR_BIT)) {
-            (void) fprintf(stderr, "Parity error\n");
-            error = 1;
-            ret = EXIT_PARITY_ERROR;
-        }
-        if (*buffer & (1 << GAME_LOST_ERR_BIT)) {
-            (void) fprintf(stderr, "Game lost\n");
-            error = 1;
-            if (ret == EXIT_PARITY_ERROR) {
-                ret = EXIT_MULTIPLE_ERRORS;
-            } else {
-                ret = EXIT_GAME_LOST;
+    workers = calloc(options.workers, sizeof(struct worker));
+    if (workers == NULL) {
+        bail_out(EXIT_FAILURE, "calloc");
+    }
+    workers_size = options.workers;
+    for (int w = 0; w < workers_size; ++w) {
+        workers[w].sockfd = -1;
+        workers[w].epollfd = -1;
+        workers[w].seed = time(NULL) ^ getpid() ^ (w << 16);
+        workers[w].options = &options;
+        if (!options.shared_secret && options.tables > 0) {
+            workers[w].tables = calloc(options.tables,
+                sizeof(struct answer_table));
+            if (workers[w].tables == NULL) {
+                bail_out(EXIT_FAILURE, "calloc");
             }
+            workers[w].tables_size = options.tables;
         }
-        if (error) {
-            break;
-        } else if (correct_guesses == SLOTS) {
-            /* won */
-            (void) printf("Runden: %d\n", round);
-            break;
+        setup_worker(&workers[w]);
+    }
+
+    /* a single worker runs in the main thread, where the signals interrupt
+       epoll_wait */
+    if (workers_size == 1) {
+        (void) run_worker(&workers[0]);
+        ret = workers[0].ret;
+        free_resources();
+        return ret;
+    }
+
+    /* the workers must not get the signals, so the main thread waits for
+       them and wakes the workers up */
+    sigset_t blocked, old;
+    (void) sigemptyset(&blocked);
+    for(int i = 0; i < COUNT_OF(signals); i++) {
+        (void) sigaddset(&blocked, signals[i]);
+    }
+    if (pthread_sigmask(SIG_BLOCK, &blocked, &old) != 0) {
+        bail_out(EXIT_FAILURE, "pthread_sigmask");
+    }
+    for (int w = 0; w < workers_size; ++w) {
+        if (pthread_create(&workers[w].thread, NULL, run_worker,
+            &workers[w]) != 0) {
+            bail_out(EXIT_FAILURE, "pthread_create");
         }
     }
+    while (!quit) {
+        (void) sigsuspend(&old);
+    }
+    errno = 0;
+    if (write(wakeup[1], "q", 1) < 0) {
+        bail_out(EXIT_FAILURE, "write");
+    }
+    for (int w = 0; w < workers_size; ++w) {
+        (void) pthread_join(workers[w].thread, NULL);
+    }
 
     /* we are done */
     free_resources();
-    return ret;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 static void parse_args(int argc, char **argv, struct opts *options)
 {
     int i;
+    int c;
     char *port_arg;
     char *secret_arg;
     char *endptr;
@@ -383,12 +1283,52 @@ static void parse_args(int argc, char **argv, struct opts *options)
     if(argc > 0) {
         progname = argv[0];
     }
-    if (argc != 3) {
-        bail_out(EXIT_FAILURE,
-            "Usage: %s <server-port> <secret-sequence>", progname);
+    options->one_game = 0;
+    options->workers = 1;
+    options->tables = 0;
+    options->admin = NULL;
+    while ((c = getopt(argc, argv, "oj:C:a:")) != -1) {
+        switch (c) {
+        case 'o':
+            options->one_game = 1;
+            break;
+        case 'j':
+            options->workers = strtol(optarg, &endptr, 10);
+            if (endptr == optarg || *endptr != '\0' || options->workers < 0) {
+                bail_out(EXIT_FAILURE, "Invalid number of workers: %s",
+                    optarg);
+            }
+            if (options->workers == 0) {
+                options->workers = online_processors();
+            }
+            break;
+        case 'C':
+            options->tables = strtol(optarg, &endptr, 10);
+            if (endptr == optarg || *endptr != '\0' || options->tables < 0 ||
+                options->tables > INT_MAX) {
+                bail_out(EXIT_FAILURE, "Invalid number of answer tables: %s",
+                    optarg);
+            }
+            break;
+        case 'a':
+            options->admin = optarg;
+            break;
+        default:
+            bail_out(EXIT_FAILURE, "Usage: %s [-o] [-j workers] [-C tables] "
+                "[-a admin-socket] <server-port> [<secret-sequence>]",
+                progname);
+        }
+    }
+    if (argc - optind != 1 && argc - optind != 2) {
+        bail_out(EXIT_FAILURE, "Usage: %s [-o] [-j workers] [-C tables] "
+            "[-a admin-socket] <server-port> [<secret-sequence>]", progname);
+    }
+    /* a single game is served by a single worker */
+    if (options->one_game) {
+        options->workers = 1;
     }
-    port_arg = argv[1];
-    secret_arg = argv[2];
+    port_arg = argv[optind];
+    secret_arg = argv[optind + 1];
 
     errno = 0;
     options->portno = strtol(port_arg, &endptr, 10);
@@ -416,6 +1356,12 @@ static void parse_args(int argc, char **argv, struct opts *options)
         bail_out(EXIT_FAILURE, "Use a valid TCP/IP port range (1-65535)");
     }
 
+    /* without a secret every game gets a random one */
+    options->shared_secret = (secret_arg != NULL);
+    if (!options->shared_secret) {
+        return;
+    }
+
     if (strlen(secret_arg) != SLOTS) {
         bail_out(EXIT_FAILURE,
             "<secret-sequence> has to be %d chars long", SLOTS);
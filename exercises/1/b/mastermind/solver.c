@@ -0,0 +1,367 @@
+/**
+ * @module solver.c
+ * @author Enri Miho - 0929003
+ * @brief guessing the secret of the mastermind server
+ * @date 17.10.2026
+ */
+
+#include <string.h>
+#include "solver.h"
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+/* === Constants === */
+
+/* The first guess, the one with the smallest worst answer (aabcd) */
+#define OPENING ((0 << 0) | (0 << 3) | (1 << 6) | (2 << 9) | (3 << 12))
+
+/* Number of answers computed to choose one guess at most; the guesses
+   are restricted to a part of the candidates beyond it */
+#define WORK_LIMIT (1L << 20)
+
+/* Number of candidates scored before checking whether a guess can still
+   be the best one */
+#define SCORE_CHUNK (1024)
+
+/* Mask of the lowest bit of each slot of a code */
+#define SLOT_LOW_BITS (011111)
+
+/* Mask of the lowest bit of each color of a color count */
+#define COLOR_LOW_BITS (0x11111111)
+
+/* The AVX2 kernel is compiled for its own target and selected at runtime,
+   so the client still runs on processors without it */
+#if defined(__SSE2__) && defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_AVX2
+#endif
+
+/* === Type Definitions === */
+
+/* A kernel of score_candidates */
+typedef void (*score_kernel)(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers);
+
+/* === Prototypes === */
+
+/**
+ * @brief Fill the candidates with all codes
+ * @param solver The solver
+ */
+static void fill_candidates(struct solver *solver);
+
+/**
+ * @brief Split a guess into its colors and color counts
+ * @param guess The code of the guess
+ * @param colors Buffer for the color of each slot
+ * @param counts Buffer for the number of pegs of each color
+ */
+static void split_guess(uint16_t guess, uint8_t *colors, uint8_t *counts);
+
+/**
+ * @brief Kernel of score_candidates computing one answer after the other
+ */
+static void score_scalar(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers);
+
+#ifdef __SSE2__
+/**
+ * @brief Kernel of score_candidates computing 16 answers at once
+ */
+static void score_sse2(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers);
+#endif
+
+#ifdef HAVE_AVX2
+/**
+ * @brief Kernel of score_candidates computing 32 answers at once
+ */
+__attribute__((target("avx2")))
+static void score_avx2(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers);
+#endif
+
+/* === Global Variables === */
+
+/* Number of pegs of each color of each code, 4 bits per color */
+static uint32_t color_counts[CODES];
+
+/* The candidates at the start of a game, copied by solver_init */
+static struct solver all_codes;
+
+/* The selected kernel */
+static score_kernel kernel = score_scalar;
+
+/* === Implementations === */
+
+void solver_init(struct solver *solver)
+{
+    static int initialized = 0;
+
+    if (!initialized) {
+        for (int code = 0; code < CODES; ++code) {
+            uint32_t counts = 0;
+            for (int j = 0; j < SLOTS; ++j) {
+                int color = (code >> (j * SHIFT_WIDTH)) & (COLORS - 1);
+                counts += 1u << (color * 4);
+            }
+            color_counts[code] = counts;
+        }
+        fill_candidates(&all_codes);
+        if (solver_use_kernel(KERNEL_AVX2) < 0 &&
+            solver_use_kernel(KERNEL_SSE2) < 0) {
+            (void) solver_use_kernel(KERNEL_SCALAR);
+        }
+        initialized = 1;
+    }
+    (void) memcpy(solver, &all_codes, sizeof(*solver));
+}
+
+static void fill_candidates(struct solver *solver)
+{
+    for (int code = 0; code < CODES; ++code) {
+        solver->candidates[code] = code;
+        for (int j = 0; j < SLOTS; ++j) {
+            solver->slots[j][code] =
+                (code >> (j * SHIFT_WIDTH)) & (COLORS - 1);
+        }
+        for (int k = 0; k < COLORS; ++k) {
+            solver->counts[k][code] = (color_counts[code] >> (k * 4)) & 0xf;
+        }
+    }
+    solver->candidates_size = CODES;
+    solver->round = 1;
+}
+
+int solver_use_kernel(enum solver_kernel selected)
+{
+    switch (selected) {
+    case KERNEL_SCALAR:
+        kernel = score_scalar;
+        return 0;
+#ifdef __SSE2__
+    case KERNEL_SSE2:
+        kernel = score_sse2;
+        return 0;
+#endif
+#ifdef HAVE_AVX2
+    case KERNEL_AVX2:
+        if (!__builtin_cpu_supports("avx2")) {
+            return -1;
+        }
+        kernel = score_avx2;
+        return 0;
+#endif
+    default:
+        return -1;
+    }
+}
+
+uint8_t score_codes(uint16_t guess, uint16_t code)
+{
+    /* a slot is red if all of its bits are equal */
+    unsigned int diff = guess ^ code;
+    diff = (diff | (diff >> 1) | (diff >> 2)) & SLOT_LOW_BITS;
+    int red = SLOTS - __builtin_popcount(diff);
+
+    /* pegs of the same color are the minimum of both counts; the counts are
+       at most SLOTS, so in a + 8 - b the bit 3 is set if a >= b without
+       borrowing from the next color */
+    uint32_t a = color_counts[guess];
+    uint32_t b = color_counts[code];
+    uint32_t ge = (((a | (COLOR_LOW_BITS << 3)) - b) >> 3) & COLOR_LOW_BITS;
+    uint32_t mask = ge * 0xf;
+    uint32_t min = (b & mask) | (a & ~mask);
+    int same = (min * COLOR_LOW_BITS) >> 28;
+
+    return red | ((same - red) << SHIFT_WIDTH);
+}
+
+uint16_t add_parity(uint16_t code)
+{
+    return code | ((__builtin_popcount(code) & 1) << 15);
+}
+
+void score_candidates(const struct solver *solver, uint16_t guess, int first,
+    int last, uint8_t *answers)
+{
+    kernel(solver, guess, first, last, answers);
+}
+
+static void split_guess(uint16_t guess, uint8_t *colors, uint8_t *counts)
+{
+    for (int j = 0; j < SLOTS; ++j) {
+        colors[j] = (guess >> (j * SHIFT_WIDTH)) & (COLORS - 1);
+    }
+    for (int k = 0; k < COLORS; ++k) {
+        counts[k] = (color_counts[guess] >> (k * 4)) & 0xf;
+    }
+}
+
+static void score_scalar(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers)
+{
+    for (int i = first; i < last; ++i) {
+        answers[i] = score_codes(guess, solver->candidates[i]);
+    }
+}
+
+#ifdef __SSE2__
+static void score_sse2(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers)
+{
+    uint8_t colors[SLOTS];
+    uint8_t counts[COLORS];
+
+    split_guess(guess, colors, counts);
+    for (int i = first; i < last; i += 16) {
+        /* a comparison gives -1 for every red slot */
+        __m128i red = _mm_setzero_si128();
+        for (int j = 0; j < SLOTS; ++j) {
+            __m128i slot = _mm_loadu_si128(
+                (const __m128i *) &solver->slots[j][i]);
+            red = _mm_sub_epi8(red,
+                _mm_cmpeq_epi8(slot, _mm_set1_epi8(colors[j])));
+        }
+        /* colors missing in the guess cannot match */
+        __m128i same = _mm_setzero_si128();
+        for (int k = 0; k < COLORS; ++k) {
+            if (counts[k] == 0) {
+                continue;
+            }
+            __m128i count = _mm_loadu_si128(
+                (const __m128i *) &solver->counts[k][i]);
+            same = _mm_add_epi8(same,
+                _mm_min_epu8(count, _mm_set1_epi8(counts[k])));
+        }
+        /* white is at most SLOTS, so the shift stays within the bytes */
+        __m128i white = _mm_sub_epi8(same, red);
+        __m128i answer = _mm_or_si128(red,
+            _mm_slli_epi16(white, SHIFT_WIDTH));
+        _mm_storeu_si128((__m128i *) &answers[i], answer);
+    }
+}
+#endif
+
+#ifdef HAVE_AVX2
+__attribute__((target("avx2")))
+static void score_avx2(const struct solver *solver, uint16_t guess,
+    int first, int last, uint8_t *answers)
+{
+    uint8_t colors[SLOTS];
+    uint8_t counts[COLORS];
+
+    split_guess(guess, colors, counts);
+    for (int i = first; i < last; i += 32) {
+        __m256i red = _mm256_setzero_si256();
+        for (int j = 0; j < SLOTS; ++j) {
+            __m256i slot = _mm256_loadu_si256(
+                (const __m256i *) &solver->slots[j][i]);
+            red = _mm256_sub_epi8(red,
+                _mm256_cmpeq_epi8(slot, _mm256_set1_epi8(colors[j])));
+        }
+        __m256i same = _mm256_setzero_si256();
+        for (int k = 0; k < COLORS; ++k) {
+            if (counts[k] == 0) {
+                continue;
+            }
+            __m256i count = _mm256_loadu_si256(
+                (const __m256i *) &solver->counts[k][i]);
+            same = _mm256_add_epi8(same,
+                _mm256_min_epu8(count, _mm256_set1_epi8(counts[k])));
+        }
+        __m256i white = _mm256_sub_epi8(same, red);
+        __m256i answer = _mm256_or_si256(red,
+            _mm256_slli_epi16(white, SHIFT_WIDTH));
+        _mm256_storeu_si256((__m256i *) &answers[i], answer);
+    }
+}
+#endif
+
+uint16_t solver_guess(const struct solver *solver)
+{
+    const uint16_t *candidates = solver->candidates;
+    int size = solver->candidates_size;
+    int use_all_codes = ((long) size * CODES <= WORK_LIMIT);
+    int pool_size = use_all_codes ? CODES : size;
+    int stride = 1;
+    int best_worst = size + 1;
+    int best_is_candidate = 0;
+    uint16_t best = candidates[0];
+    int next_candidate = 0;
+    uint8_t answers[CODES];
+
+    if (solver->round == 1) {
+        return OPENING;
+    }
+    if (size <= 2) {
+        return candidates[0];
+    }
+    if (!use_all_codes && (long) size * size > WORK_LIMIT) {
+        stride = (long) size * size / WORK_LIMIT + 1;
+    }
+
+    for (int i = 0; i < pool_size; i += stride) {
+        uint16_t guess = use_all_codes ? i : candidates[i];
+        int is_candidate = 1;
+        if (use_all_codes) {
+            /* the candidates are sorted, so they are passed in order */
+            while (next_candidate < size &&
+                candidates[next_candidate] < guess) {
+                next_candidate++;
+            }
+            is_candidate = (next_candidate < size &&
+                candidates[next_candidate] == guess);
+        }
+
+        /* stop as soon as the guess cannot be better than the best one */
+        int partition[ANSWERS];
+        int worst = 0;
+        (void) memset(partition, 0, sizeof(partition));
+        for (int first = 0; first < size && worst <= best_worst;
+            first += SCORE_CHUNK) {
+            int last = (first + SCORE_CHUNK < size)
+                ? first + SCORE_CHUNK : size;
+            score_candidates(solver, guess, first, last, answers);
+            for (int c = first; c < last; ++c) {
+                int n = ++partition[answers[c]];
+                if (n > worst) {
+                    worst = n;
+                }
+            }
+        }
+        if (worst < best_worst ||
+            (worst == best_worst && is_candidate && !best_is_candidate)) {
+            best = guess;
+            best_worst = worst;
+            best_is_candidate = is_candidate;
+        }
+    }
+    return best;
+}
+
+int solver_answer(struct solver *solver, uint16_t guess, uint8_t answer)
+{
+    uint8_t answers[CODES];
+    int kept = 0;
+
+    score_candidates(solver, guess, 0, solver->candidates_size, answers);
+    for (int c = 0; c < solver->candidates_size; ++c) {
+        if (answers[c] != answer) {
+            continue;
+        }
+        /* kept never passes c, so the arrays are compacted in place */
+        solver->candidates[kept] = solver->candidates[c];
+        for (int j = 0; j < SLOTS; ++j) {
+            solver->slots[j][kept] = solver->slots[j][c];
+        }
+        for (int k = 0; k < COLORS; ++k) {
+            solver->counts[k][kept] = solver->counts[k][c];
+        }
+        kept++;
+    }
+    solver->candidates_size = kept;
+    solver->round++;
+    return kept;
+}
@@ -0,0 +1,100 @@
+/**
+ * @module solver.h
+ * @author Enri Miho - 0929003
+ * @brief guessing the secret of the mastermind server
+ * @date 17.10.2026
+ */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdint.h>
+#include "answer.h"
+
+/* Number of codes, i.e. guesses without the parity bit */
+#define CODES (ANSWER_TABLE_SIZE)
+
+/* The answer to the secret itself */
+#define ANSWER_WON (SLOTS)
+
+/* Number of different answers, indexed by the answer byte */
+#define ANSWERS (1 << 6)
+
+/* The kernels computing the answers for many candidates at once */
+enum solver_kernel { KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2 };
+
+/* State of the solver during one game; the candidates are stored as
+   structure of arrays, one byte per candidate in every array, so a kernel
+   handles as many candidates as a vector register has bytes */
+struct solver {
+    uint16_t candidates[CODES];    /* codes consistent with all answers */
+    uint8_t slots[SLOTS][CODES];   /* color of each slot of candidates */
+    uint8_t counts[COLORS][CODES]; /* number of pegs of each color */
+    int candidates_size;           /* number of entries of candidates */
+    int round;                     /* number of the next round */
+};
+
+/**
+ * @brief Start a new game
+ * @param solver The solver
+ */
+void solver_init(struct solver *solver);
+
+/**
+ * @brief Choose the next guess
+ *
+ * The guess is the one whose worst answer leaves the fewest candidates
+ * (Knuth's minimax), preferring candidates on ties, so it may win at once.
+ *
+ * @param solver The solver
+ * @return The code of the guess, without parity bit
+ */
+uint16_t solver_guess(const struct solver *solver);
+
+/**
+ * @brief Remove the candidates which are not consistent with an answer
+ * @param solver The solver
+ * @param guess The code of the guess
+ * @param answer The answer of the server, without error bits
+ * @return The number of candidates left
+ */
+int solver_answer(struct solver *solver, uint16_t guess, uint8_t answer);
+
+/**
+ * @brief Compute the answers to a guess for a range of candidates
+ * @param solver The solver
+ * @param guess The code of the guess
+ * @param first Index of the first candidate, a multiple of 32
+ * @param last Index after the last candidate
+ * @param answers CODES entries, indexed like the candidates; entries up to
+ * the next multiple of 32 after last may be overwritten
+ */
+void score_candidates(const struct solver *solver, uint16_t guess, int first,
+    int last, uint8_t *answers);
+
+/**
+ * @brief Select the kernel of score_candidates
+ *
+ * solver_init selects the fastest kernel supported by the processor.
+ *
+ * @param kernel The kernel
+ * @return 0 on success, -1 if the processor does not support it
+ */
+int solver_use_kernel(enum solver_kernel kernel);
+
+/**
+ * @brief Compute the answer to a guess if a code is the secret
+ * @param guess The code of the guess
+ * @param code The code taken as secret
+ * @return The answer like the server sends it, without error bits
+ */
+uint8_t score_codes(uint16_t guess, uint16_t code);
+
+/**
+ * @brief Add the parity bit to a code
+ * @param code The code
+ * @return The request for the code
+ */
+uint16_t add_parity(uint16_t code);
+
+#endif /* SOLVER_H */
@@ -0,0 +1,122 @@
+/**
+ * @module solver_bench.c
+ * @author Enri Miho - 0929003
+ * @brief microbenchmark of the kernels of the solver
+ * @date 17.10.2026
+ * @details Checks that every kernel gives the same answers as score_codes, then times each of them scoring all
+ * candidates, filtering them after the opening guess and solving whole games.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "solver.h"
+
+/* === Constants === */
+
+#define GUESSES (64)
+#define GAMES (16)
+#define DEFAULT_ROUNDS (200)
+
+/* === Global Variables === */
+
+/** The state of the solver, too large for the stack **/
+static struct solver solver;
+
+/** The answers of a kernel **/
+static uint8_t answers[CODES];
+
+/* === Prototypes === */
+
+/**
+ * @brief Returns the time of the monotonic clock
+ * @return The time in seconds
+ */
+static double now(void);
+
+/* === Implementations === */
+
+static double now(void){
+
+	struct timespec time;
+	(void) clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec/1e9;
+}
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if a kernel gives a different answer
+ */
+int main(int argc, char **argv){
+
+	const char *names[] = {"scalar", "sse2", "avx2"};
+	const enum solver_kernel kernels[] = {KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2};
+	long int rounds = (argc > 1) ? strtol(argv[1], NULL, 10) : DEFAULT_ROUNDS;
+	if(rounds < 1){
+		(void) fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	solver_init(&solver);
+
+	for(int k=0; k<sizeof(kernels)/sizeof(kernels[0]); k++){
+		if(solver_use_kernel(kernels[k]) < 0){
+			(void) printf("%-6s not supported\n", names[k]);
+			continue;
+		}
+
+		//every candidate against some guesses
+		srand(1);
+		for(int g=0; g<GUESSES; g++){
+			uint16_t guess = rand() % CODES;
+			score_candidates(&solver, guess, 0, CODES, answers);
+			for(int c=0; c<CODES; c++){
+				if(answers[c] != score_codes(guess, c)){
+					(void) fprintf(stderr, "%s: %s: guess 0x%x, code 0x%x: 0x%x instead of 0x%x\n", argv[0],
+						names[k], guess, c, answers[c], score_codes(guess, c));
+					return EXIT_FAILURE;
+				}
+			}
+		}
+
+		double start = now();
+		for(long int r=0; r<rounds; r++){
+			score_candidates(&solver, r % CODES, 0, CODES, answers);
+		}
+		double score = (now()-start)/rounds;
+
+		//the opening guess leaves the most candidates for the secret 0
+		uint16_t opening = solver_guess(&solver);
+		uint8_t answer = score_codes(opening, 0);
+		start = now();
+		for(long int r=0; r<rounds; r++){
+			solver_init(&solver);
+			(void) solver_answer(&solver, opening, answer);
+		}
+		double filter = (now()-start)/rounds;
+
+		int played = 0;
+		start = now();
+		for(int g=0; g<GAMES; g++){
+			uint16_t secret = rand() % CODES;
+			solver_init(&solver);
+			for(;;){
+				uint16_t guess = solver_guess(&solver);
+				played++;
+				answer = score_codes(guess, secret);
+				if(answer == ANSWER_WON){
+					break;
+				}
+				(void) solver_answer(&solver, guess, answer);
+			}
+		}
+		double game = (now()-start)/GAMES;
+		solver_init(&solver);
+
+		(void) printf("%-6s score %7.1f M candidates/s, filter %7.1f M candidates/s, %6.2f ms/game (%.2f rounds)\n",
+			names[k], CODES/score/1e6, CODES/filter/1e6, game*1e3, (double) played/GAMES);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,440 @@
+/**
+ * @file bench.c
+ * @author Enri Miho (0929003) <e0929003@student.tuwien.ac.at>
+ * @date 2026-10-17
+ * @brief A benchmark runner for forksort.
+ * @details Generates every dataset in every size with gen and runs forksort on it in every mode. For each run the
+ * wall time, the throughput, the peak resident set size of the largest forksort process and the number of forked
+ * processes are reported. A mode is a list of forksort options; if its last option is -f, the generated file is
+ * passed with -f, otherwise it is given on stdin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/* === Constants === */
+
+/// The maximum number of sizes, datasets and modes
+#define MAX_ENTRIES (32)
+
+/// The maximum number of options of a mode
+#define MAX_MODE_ARGS (16)
+
+/// Forksort without -j forks about two processes per line, so larger inputs are skipped for such modes
+#define UNBOUNDED_MAX_LINES (10000)
+
+/// The lines of the staircase dataset are 2 KB long on average, so larger sizes are skipped for it
+#define STAIRCASE_MAX_LINES (100000)
+
+/// The default sizes
+#define DEFAULT_SIZES "1000,100000,1000000,10000000"
+
+/// The default datasets
+#define DEFAULT_DATASETS "uniform,sorted,reverse,few-unique,prefix,staircase"
+
+/// The default modes, separated by ','
+#define DEFAULT_MODES ",-j 0,-j 0 -x,-j 0 -s,-j 0 -p,-j 0 -p -s,-j 0 -a radix,-j 0 -f,-m 64M"
+
+/* === Type Definitions === */
+
+/**
+ * A structure to represent the measurements of one run.
+ */
+struct result {
+	/// The exit status of forksort as returned by waitpid
+	int status;
+	/// The wall time in seconds
+	double seconds;
+	/// The maximum resident set size of the largest process in kilobytes
+	long int max_rss;
+	/// The number of processes forked while forksort ran, system wide
+	long int processes;
+};
+
+/* === Global Variables === */
+
+/** Name of the program **/
+static const char *progname = "bench";
+
+/** The temporary directory of the generated files **/
+static char directory[] = "/tmp/forksort-bench-XXXXXX";
+
+/** Set if the temporary directory was created **/
+static int directory_created = 0;
+
+/** Set in the forked children, which must neither remove the temporary directory nor flush the parent's output **/
+static int forked_child = 0;
+
+/* === Prototypes === */
+
+/**
+ * @brief Splits a list at the given separator, in place
+ * @param list The list, which is modified
+ * @param separator The separator
+ * @param entries The array where the entries are stored
+ * @param max_entries The size of entries
+ * @return The number of entries
+ */
+static int split(char *list, char separator, char **entries, int max_entries);
+
+/**
+ * @brief Runs gen and writes its output to a file
+ * @param dataset The dataset
+ * @param lines The number of lines
+ * @param raw Set to generate the lines without the number of lines
+ * @param path The file
+ */
+static void generate(const char *dataset, long int lines, int raw, const char *path);
+
+/**
+ * @brief Runs forksort once in a separate measuring process and measures it
+ * @param forksort_dir The directory containing forksort, which also has to be the working directory
+ * @param mode The options of forksort
+ * @param input The file given on stdin, or with -f if the mode ends with -f
+ * @param result The measurements
+ */
+static void measure(const char *forksort_dir, const char *mode, const char *input, struct result *result);
+
+/**
+ * @brief Returns the number of processes forked since boot from /proc/stat
+ * @return The number of processes, -1 if unknown
+ */
+static long int forked_processes(void);
+
+/**
+ * @brief terminate program on program error; a forked child only reports the error and leaves with _exit
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/**
+ * @brief free allocated resources
+ */
+static void free_resources(void);
+
+/* === Implementations === */
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS if all runs succeeded, EXIT_FAILURE otherwise
+ */
+int main(int argc, char **argv){
+
+	const char *usage = "Usage: %s [-C forksort-dir] [-n sizes] [-d datasets] [-m mode]...";
+	const char *forksort_dir = "../src";
+	char sizes_list[] = DEFAULT_SIZES;
+	char datasets_list[] = DEFAULT_DATASETS;
+	char modes_list[] = DEFAULT_MODES;
+	char *sizes[MAX_ENTRIES];
+	char *datasets[MAX_ENTRIES];
+	char *modes[MAX_ENTRIES];
+	int sizes_size = 0;
+	int datasets_size = 0;
+	int modes_size = 0;
+
+	progname = argv[0];
+	int opt;
+	while((opt = getopt(argc, argv, "C:n:d:m:")) != -1){
+		switch(opt){
+			case 'C':
+				forksort_dir = optarg;
+				break;
+			case 'n':
+				sizes_size = split(optarg, ',', sizes, MAX_ENTRIES);
+				break;
+			case 'd':
+				datasets_size = split(optarg, ',', datasets, MAX_ENTRIES);
+				break;
+			case 'm':
+				if(modes_size == MAX_ENTRIES){
+					bail_out(EXIT_FAILURE, "Too many modes");
+				}
+				modes[modes_size++] = optarg;
+				break;
+			default:
+				bail_out(EXIT_FAILURE, usage, progname);
+		}
+	}
+	if(optind != argc){
+		bail_out(EXIT_FAILURE, usage, progname);
+	}
+	if(sizes_size == 0){
+		sizes_size = split(sizes_list, ',', sizes, MAX_ENTRIES);
+	}
+	if(datasets_size == 0){
+		datasets_size = split(datasets_list, ',', datasets, MAX_ENTRIES);
+	}
+	if(modes_size == 0){
+		modes_size = split(modes_list, ',', modes, MAX_ENTRIES);
+	}
+
+	if(mkdtemp(directory) == NULL){
+		bail_out(EXIT_FAILURE, "mkdtemp");
+	}
+	directory_created = 1;
+	char input[sizeof(directory)+16];
+	char raw_input[sizeof(directory)+16];
+	(void) sprintf(input, "%s/input", directory);
+	(void) sprintf(raw_input, "%s/raw", directory);
+
+	int ret = EXIT_SUCCESS;
+	(void) printf("%-10s %9s  %-16s %9s %12s %8s %10s %9s\n",
+		"dataset", "lines", "mode", "wall[s]", "lines/s", "MB/s", "maxrss[KB]", "processes");
+	for(int d=0; d<datasets_size; d++){
+		for(int n=0; n<sizes_size; n++){
+			char *endptr;
+			long int lines = strtol(sizes[n], &endptr, 10);
+			if(*endptr != '\0' || lines < 1){
+				bail_out(EXIT_FAILURE, "Invalid size: %s", sizes[n]);
+			}
+			if(strcmp(datasets[d], "staircase") == 0 && lines > STAIRCASE_MAX_LINES){
+				for(int m=0; m<modes_size; m++){
+					(void) printf("%-10s %9ld  %-16s %9s\n", datasets[d], lines,
+						(*modes[m] == '\0') ? "(none)" : modes[m], "skipped");
+				}
+				continue;
+			}
+			generate(datasets[d], lines, 0, input);
+			generate(datasets[d], lines, 1, raw_input);
+			struct stat st;
+			if(stat(raw_input, &st) < 0){
+				bail_out(EXIT_FAILURE, "stat");
+			}
+
+			for(int m=0; m<modes_size; m++){
+				const char *mode = modes[m];
+				(void) printf("%-10s %9ld  %-16s ", datasets[d], lines, (*mode == '\0') ? "(none)" : mode);
+				if(strstr(mode, "-j") == NULL && strstr(mode, "-p") == NULL && strstr(mode, "-m") == NULL &&
+						lines > UNBOUNDED_MAX_LINES){
+					(void) printf("%9s\n", "skipped");
+					continue;
+				}
+				(void) fflush(stdout);
+
+				struct result result;
+				size_t mode_length = strlen(mode);
+				int file_mode = mode_length >= 2 && strcmp(mode+mode_length-2, "-f") == 0;
+				measure(forksort_dir, mode, file_mode ? raw_input : input, &result);
+				if(!WIFEXITED(result.status) || WEXITSTATUS(result.status) != EXIT_SUCCESS){
+					(void) printf("%9s\n", "FAILED");
+					ret = EXIT_FAILURE;
+					continue;
+				}
+				(void) printf("%9.3f %12.0f %8.1f %10ld %9ld\n", result.seconds, lines/result.seconds,
+					st.st_size/result.seconds/(1024*1024), result.max_rss, result.processes);
+			}
+		}
+	}
+
+	free_resources();
+	return ret;
+}
+
+static int split(char *list, char separator, char **entries, int max_entries){
+
+	int count = 0;
+	char *entry = list;
+	while(1){
+		if(count == max_entries){
+			bail_out(EXIT_FAILURE, "Too many entries in %s", list);
+		}
+		entries[count++] = entry;
+		char *end = strchr(entry, separator);
+		if(end == NULL){
+			break;
+		}
+		*end = '\0';
+		entry = end+1;
+	}
+	return count;
+}
+
+static void generate(const char *dataset, long int lines, int raw, const char *path){
+
+	char lines_str[32];
+	(void) sprintf(lines_str, "%ld", lines);
+
+	pid_t pid = fork();
+	if(pid == 0){
+		forked_child = 1;
+		int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0600);
+		if(fd < 0 || dup2(fd, fileno(stdout)) < 0){
+			bail_out(EXIT_FAILURE, "open %s", path);
+		}
+		(void) close(fd);
+		if(raw){
+			(void) execl("./gen", "gen", "-r", dataset, lines_str, (char *) NULL);
+		}
+		else{
+			(void) execl("./gen", "gen", dataset, lines_str, (char *) NULL);
+		}
+		bail_out(EXIT_FAILURE, "execl gen");
+	}
+	else if(pid < 0){
+		bail_out(EXIT_FAILURE, "fork");
+	}
+
+	int status;
+	if(waitpid(pid, &status, 0) < 0){
+		bail_out(EXIT_FAILURE, "waitpid");
+	}
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS){
+		bail_out(EXIT_FAILURE, "gen %s %ld failed", dataset, lines);
+	}
+}
+
+static void measure(const char *forksort_dir, const char *mode, const char *input, struct result *result){
+
+	int fd[2];
+	if(pipe(fd) < 0){
+		bail_out(EXIT_FAILURE, "pipe");
+	}
+	(void) fflush(stdout);
+
+	//the rusage of the children of this measuring process only covers forksort and its descendants
+	pid_t pid = fork();
+	if(pid == 0){
+		forked_child = 1;
+		(void) close(fd[0]);
+
+		char mode_copy[256];
+		char *args[MAX_MODE_ARGS+4];
+		int count = 0;
+		(void) snprintf(mode_copy, sizeof(mode_copy), "%s", mode);
+		args[count++] = "forksort";
+		for(char *token = strtok(mode_copy, " "); token != NULL; token = strtok(NULL, " ")){
+			if(count == MAX_MODE_ARGS){
+				bail_out(EXIT_FAILURE, "Too many options in mode %s", mode);
+			}
+			args[count++] = token;
+		}
+		int file_mode = count > 1 && strcmp(args[count-1], "-f") == 0;
+		if(file_mode){
+			args[count++] = (char *) input;
+		}
+		args[count] = NULL;
+
+		struct result measured;
+		long int processes_before = forked_processes();
+		struct timespec start, end;
+		(void) clock_gettime(CLOCK_MONOTONIC, &start);
+
+		pid_t forksort = fork();
+		if(forksort == 0){
+			int in = file_mode ? open("/dev/null", O_RDONLY) : open(input, O_RDONLY);
+			int out = open("/dev/null", O_WRONLY);
+			if(in < 0 || out < 0 || dup2(in, fileno(stdin)) < 0 || dup2(out, fileno(stdout)) < 0){
+				bail_out(EXIT_FAILURE, "redirecting forksort");
+			}
+			(void) close(in);
+			(void) close(out);
+			(void) close(fd[1]);
+			//forksort executes ./forksort for its children
+			if(chdir(forksort_dir) < 0){
+				bail_out(EXIT_FAILURE, "chdir %s", forksort_dir);
+			}
+			(void) execv("./forksort", args);
+			bail_out(EXIT_FAILURE, "execv forksort");
+		}
+		else if(forksort < 0){
+			bail_out(EXIT_FAILURE, "fork");
+		}
+		while(waitpid(forksort, &measured.status, 0) < 0){
+			if(errno != EINTR){
+				bail_out(EXIT_FAILURE, "waitpid");
+			}
+		}
+		(void) clock_gettime(CLOCK_MONOTONIC, &end);
+		long int processes_after = forked_processes();
+
+		struct rusage usage;
+		(void) getrusage(RUSAGE_CHILDREN, &usage);
+		measured.seconds = (end.tv_sec-start.tv_sec) + (end.tv_nsec-start.tv_nsec)/1e9;
+		measured.max_rss = usage.ru_maxrss;
+		measured.processes = (processes_before < 0 || processes_after < 0) ? -1 : processes_after-processes_before;
+		if(write(fd[1], &measured, sizeof(measured)) != sizeof(measured)){
+			bail_out(EXIT_FAILURE, "write");
+		}
+		_exit(EXIT_SUCCESS);
+	}
+	else if(pid < 0){
+		bail_out(EXIT_FAILURE, "fork");
+	}
+
+	(void) close(fd[1]);
+	ssize_t r = read(fd[0], result, sizeof(*result));
+	(void) close(fd[0]);
+	int status;
+	if(waitpid(pid, &status, 0) < 0){
+		bail_out(EXIT_FAILURE, "waitpid");
+	}
+	if(r != sizeof(*result)){
+		bail_out(EXIT_FAILURE, "measuring %s failed", mode);
+	}
+}
+
+static long int forked_processes(void){
+
+	FILE *file = fopen("/proc/stat", "r");
+	if(file == NULL){
+		return -1;
+	}
+	char line[256];
+	long int processes = -1;
+	while(fgets(line, sizeof(line), file) != NULL){
+		if(sscanf(line, "processes %ld", &processes) == 1){
+			break;
+		}
+	}
+	(void) fclose(file);
+	return processes;
+}
+
+static void bail_out(int exitcode, const char *fmt, ...){
+
+	va_list ap;
+
+	(void) fprintf(stderr, "%s: ", progname);
+	if (fmt != NULL) {
+		va_start(ap, fmt);
+		(void) vfprintf(stderr, fmt, ap);
+		va_end(ap);
+	}
+	if (errno != 0) {
+		(void) fprintf(stderr, ": %s", strerror(errno));
+	}
+	(void) fprintf(stderr, "\n");
+
+	if(forked_child){
+		_exit(exitcode);
+	}
+	free_resources();
+	exit(exitcode);
+}
+
+static void free_resources(void){
+
+	if(!directory_created){
+		return;
+	}
+	char path[sizeof(directory)+16];
+	(void) sprintf(path, "%s/input", directory);
+	(void) unlink(path);
+	(void) sprintf(path, "%s/raw", directory);
+	(void) unlink(path);
+	(void) rmdir(directory);
+}
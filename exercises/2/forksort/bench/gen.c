@@ -0,0 +1,245 @@
+/**
+ * @file gen.c
+ * @author Enri Miho (0929003) <e0929003@student.tuwien.ac.at>
+ * @date 2026-10-17
+ * @brief A deterministic input generator for forksort benchmarks.
+ * @details Prints the given number of lines of one dataset, preceded by the number of lines like forksort expects it
+ * on stdin. With -r only the lines are printed, like forksort expects them in a file given with -f. The same seed
+ * always produces the same lines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+/* === Constants === */
+
+/// The default seed of the random number generator
+#define DEFAULT_SEED (1)
+
+/// The number of distinct lines of the few-unique dataset
+#define FEW_UNIQUE_LINES (16)
+
+/// The number of letters of the key which orders the sorted and reverse datasets
+#define KEY_LENGTH (10)
+
+/// The prefix shared by all lines of the prefix dataset
+#define SHARED_PREFIX "https://www.example.com/osue/ws2015/exercises/2/forksort/benchmark/datasets/shared/prefix/" \
+	"which/is/long/enough/that/comparisons/spend/most/of/their/time/in/it/"
+
+/// The number of different lengths of the run of 'a' in front of every line of the staircase dataset
+#define STAIRCASE_STEPS (4096)
+
+/* === Type Definitions === */
+
+/// The kind of lines which are generated.
+typedef enum {UNIFORM, SORTED, REVERSE, FEW_UNIQUE, PREFIX, STAIRCASE} Dataset;
+
+/* === Global Variables === */
+
+/** Name of the program **/
+static const char *progname = "gen";
+
+/** The state of the random number generator **/
+static uint64_t random_state;
+
+/* === Prototypes === */
+
+/**
+ * @brief Returns the next random number (xorshift64*)
+ * @return The random number
+ */
+static uint64_t next_random(void);
+
+/**
+ * @brief Prints random lowercase letters
+ * @param count The number of letters
+ */
+static void print_letters(int count);
+
+/**
+ * @brief Prints a number as fixed width key of lowercase letters, so the keys sort like the numbers
+ * @param number The number
+ */
+static void print_key(long int number);
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/* === Implementations === */
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ */
+int main(int argc, char **argv){
+
+	const char *usage = "Usage: %s [-r] [-s seed] uniform|sorted|reverse|few-unique|prefix|staircase lines";
+	int raw = 0;
+	uint64_t seed = DEFAULT_SEED;
+
+	progname = argv[0];
+	char *endptr;
+	int opt;
+	while((opt = getopt(argc, argv, "rs:")) != -1){
+		switch(opt){
+			case 'r':
+				raw = 1;
+				break;
+			case 's':
+				//strtoull would accept a negative seed and wrap it around
+				errno = 0;
+				seed = strtoull(optarg, &endptr, 10);
+				if(errno != 0 || endptr == optarg || *endptr != '\0' || optarg[0] == '-'){
+					errno = 0;
+					bail_out(EXIT_FAILURE, usage, progname);
+				}
+				break;
+			default:
+				bail_out(EXIT_FAILURE, usage, progname);
+		}
+	}
+	if(argc-optind != 2){
+		bail_out(EXIT_FAILURE, usage, progname);
+	}
+
+	Dataset dataset;
+	const char *name = argv[optind];
+	if(strcmp(name, "uniform") == 0){
+		dataset = UNIFORM;
+	}
+	else if(strcmp(name, "sorted") == 0){
+		dataset = SORTED;
+	}
+	else if(strcmp(name, "reverse") == 0){
+		dataset = REVERSE;
+	}
+	else if(strcmp(name, "few-unique") == 0){
+		dataset = FEW_UNIQUE;
+	}
+	else if(strcmp(name, "prefix") == 0){
+		dataset = PREFIX;
+	}
+	else if(strcmp(name, "staircase") == 0){
+		dataset = STAIRCASE;
+	}
+	else{
+		bail_out(EXIT_FAILURE, usage, progname);
+	}
+
+	errno = 0;
+	long int lines = strtol(argv[optind+1], &endptr, 10);
+	if(errno != 0 || endptr == argv[optind+1] || *endptr != '\0' || lines < 1){
+		bail_out(EXIT_FAILURE, "Invalid number of lines: %s", argv[optind+1]);
+	}
+	errno = 0;
+
+	//xorshift must not start with 0
+	random_state = seed*2654435761ULL + 1;
+
+	uint64_t few_unique_seeds[FEW_UNIQUE_LINES];
+	for(int i=0; i<FEW_UNIQUE_LINES; i++){
+		few_unique_seeds[i] = next_random();
+	}
+
+	if(!raw){
+		(void) printf("%ld\n", lines);
+	}
+	for(long int i=0; i<lines; i++){
+		switch(dataset){
+			case UNIFORM:
+				print_letters(8 + next_random()%25);
+				break;
+			case SORTED:
+				print_key(i);
+				print_letters(next_random()%16);
+				break;
+			case REVERSE:
+				print_key(lines-1-i);
+				print_letters(next_random()%16);
+				break;
+			case FEW_UNIQUE: {
+				//replay the generator from the seed of the chosen line
+				uint64_t state = random_state;
+				random_state = few_unique_seeds[next_random()%FEW_UNIQUE_LINES];
+				print_letters(8 + next_random()%25);
+				random_state = state;
+				break;
+			}
+			case PREFIX:
+				(void) fputs(SHARED_PREFIX, stdout);
+				print_letters(12);
+				break;
+			case STAIRCASE: {
+				//the lines share prefixes of every length, which a radix sort follows byte by byte
+				int steps = next_random()%STAIRCASE_STEPS;
+				for(int j=0; j<steps; j++){
+					(void) putchar('a');
+				}
+				(void) putchar('b');
+				break;
+			}
+		}
+		(void) putchar('\n');
+	}
+
+	if(fflush(stdout) != 0){
+		bail_out(EXIT_FAILURE, "fflush");
+	}
+	return EXIT_SUCCESS;
+}
+
+static uint64_t next_random(void){
+
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 2685821657736338717ULL;
+}
+
+static void print_letters(int count){
+
+	for(int i=0; i<count; i++){
+		(void) putchar('a' + next_random()%26);
+	}
+}
+
+static void print_key(long int number){
+
+	char key[KEY_LENGTH+1];
+	for(int i=KEY_LENGTH-1; i>=0; i--){
+		key[i] = 'a' + number%26;
+		number /= 26;
+	}
+	key[KEY_LENGTH] = '\0';
+	(void) fputs(key, stdout);
+}
+
+static void bail_out(int exitcode, const char *fmt, ...){
+
+	va_list ap;
+
+	(void) fprintf(stderr, "%s: ", progname);
+	if (fmt != NULL) {
+		va_start(ap, fmt);
+		(void) vfprintf(stderr, fmt, ap);
+		va_end(ap);
+	}
+	if (errno != 0) {
+		(void) fprintf(stderr, ": %s", strerror(errno));
+	}
+	(void) fprintf(stderr, "\n");
+
+	exit(exitcode);
+}
@@ -5,6 +5,36 @@
  * @brief A forksort implementation which sorts a given number of strings.
  * @details Forksort works like mergesort. Everytime we split the inputs, the actual process is forked. This is done 
  * until the number of strings is equal to one. Then the sorted strings are merged back. 
+ * With -j the process tree is bounded to the given number of workers: every split hands half of the workers to each 
+ * child and a process with only one worker left sorts its strings in memory instead of forking again.
+ * Strings may have any length. Between the processes every string is sent as a record, which is its length followed 
+ * by its bytes, so the newlines only matter for the input and output of the first process.
+ * With -f the lines of a file are sorted instead of stdin. The file is mapped into memory and only an index of the 
+ * lines is built. Children map the same file and get only their range of it, and they return their sorted index 
+ * instead of the lines, so no line is copied through a pipe.
+ * With -x the children are not executed again. A child continues with its half of the strings, which it shares 
+ * copy-on-write with its parent, and returns its sorted index like with -f.
+ * With -s (which implies -x) the children store their sorted index in a shared memory region provided by the 
+ * parent instead of sending it through a pipe, and the parent merges from there after the children terminated.
+ * The sort used in memory is selected with -a: a merge sort, a multikey quicksort or an MSD radix sort. The latter 
+ * two look at every byte only once per level, so strings with long common prefixes are not compared again and again.
+ * With -m the memory is bounded: the input is sorted in chunks which fit the given budget, every chunk is written 
+ * as a sorted run to a temporary file, and the runs are merged with a loser tree. Chunks are sorted without forking. 
+ * Every MERGE_FAN_IN runs of a level are merged into one run of the next level, so each string is only written 
+ * again once per level.
+ * With -p (which implies -x) the strings are not halved by position but partitioned by key range: splitters are 
+ * picked from a random sample, every string is routed to the worker responsible for its range, and the sorted 
+ * partitions are printed one after another, so there is no merge at all.
+ * The order is byte by byte by default. With -k only the given field is compared, where fields are separated by the 
+ * delimiter given with -t or by blanks, -n compares the field as number and -r reverses the order. Lines with equal 
+ * keys are ordered by all their bytes. With -c equal lines, or lines with equal keys, are printed once with their 
+ * number of occurrences like uniq -c. With -k that is the whole first line of each group in the input, not only its 
+ * key, as ties keep the input order. Duplicates are collapsed by every process, so each child returns every key 
+ * once with its count and a merge only has to add the counts of keys both children returned.
+ * With -T every process appends the duration of its stages (read, fork, write, wait, readback, merge, sort) to the 
+ * given file as CSV, together with its pid, the pid of its parent and its depth in the process tree. The start of 
+ * every stage is taken from the monotonic clock, which all processes share, so the stages of the whole tree can be 
+ * lined up to find the critical path.
  */
 
 #include <stdio.h>
@@ -13,16 +43,166 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
+#include <time.h>
 
 /* === Constants === */
 
-/// The maximum length of a string. The 62th character can be used for null termination if needed
+/// The maximum length of the line containing the number of strings, including newline and null termination
 #define MAX_LENGTH (62+1)
 
+/// The number of bytes in front of every string of a record, holding the length of the string
+#define RECORD_HEADER_SIZE (sizeof(uint32_t))
+
+/// Value of workers if no -j option was given, i.e. fork until only one string is left
+#define UNBOUNDED_WORKERS (0)
+
+/// The minimum number of bytes the arena grows by
+#define ARENA_CHUNK (1024*1024)
+
+/// Below this number of strings the sorts in memory switch to insertion sort
+#define INSERTION_SORT_THRESHOLD (16)
+
+/// Below this number of strings the radix sort switches to the multikey quicksort
+#define RADIX_SORT_THRESHOLD (64)
+
+/// The number of buckets of the radix sort: one for strings which end before the current byte and one per byte value
+#define RADIX_BUCKETS (256+1)
+
+/// The maximum number of runs which are kept at once with -m
+#define MAX_RUNS (128)
+
+/// The number of runs of one level which are merged into a run of the next level with -m
+#define MERGE_FAN_IN (32)
+
+/// The size of the stdio buffer of every run file
+#define RUN_BUFFER_SIZE (64*1024)
+
+/// The name of the temporary run files, created in $TMPDIR or /tmp
+#define RUN_FILE_NAME "forksort-run-XXXXXX"
+
+/// The number of sampled strings per worker from which the splitters are picked with -p
+#define SAMPLES_PER_WORKER (64)
+
+/// The size of the buffer in which the output of a process is gathered before it is written
+#define OUTPUT_BUFFER_SIZE (256*1024)
+
+/// The width of the number of occurrences printed in front of every line with -c, like uniq -c
+#define COUNT_WIDTH (7)
+
+/// The first line of the trace file written with -T
+#define TRACE_HEADER "pid,ppid,depth,stage,start_ns,duration_ns\n"
+
+/* === Type Definitions === */
+
+/// The sort which is used to sort strings in memory.
+typedef enum {MERGE, QUICK, RADIX} Engine;
+
+/**
+ * A structure to represent the memory which holds the bytes of all strings of a process.
+ * The strings are stored one after another as records, so they are only addressed by offsets. Thereby any range of
+ * consecutive strings can be sent to a child without copying it.
+ */
+struct arena {
+	/// The bytes of all strings
+	char *data;
+	/// The number of used bytes
+	size_t size;
+	/// The allocated number of bytes
+	size_t capacity;
+};
+
+/**
+ * A structure to represent one string stored in the arena or the mapped input file.
+ */
+struct string {
+	/// The offset of the first byte in the arena, following the record header, or in the mapped input file
+	size_t offset;
+	/// The number of bytes, without newline
+	size_t length;
+};
+
+/**
+ * A structure to represent the communication with one forked child.
+ */
+struct child {
+	/// The process id of the child
+	pid_t pid;
+	/// The parent's end of the pipe to the redirected stdin of the child, -1 if closed
+	int write_fd;
+	/// The parent's end of the pipe from the redirected stdout of the child, -1 if closed
+	int read_fd;
+	/// The first line which is sent to the child, containing the number of strings
+	char header[MAX_LENGTH];
+	/// The number of bytes in header
+	size_t header_size;
+	/// The strings which are sent to the child, pointing into the arena
+	const char *input;
+	/// The number of bytes in input
+	size_t input_size;
+	/// The number of bytes of header and input already written to the child
+	size_t written;
+	/// The stream on read_fd from which the sorted strings are merged
+	FILE *output;
+	/// The string of the child which is currently merged, pointing into buffer or the mapped input file
+	const char *current;
+	/// The number of bytes in current
+	size_t current_length;
+	/// The number of occurrences of current with -c, otherwise 1
+	long int current_count;
+	/// The buffer where the strings received from the child are stored
+	char *buffer;
+	/// The allocated size of buffer
+	size_t buffer_capacity;
+	/// The sorted strings of the child in shared memory with -s
+	struct string *results;
+	/// The number of strings in results
+	long int results_size;
+	/// The number of strings of results already merged
+	long int results_read;
+};
+
+/**
+ * A structure to represent one sorted run which was written to a temporary file with -m.
+ */
+struct run {
+	/// The temporary file, already unlinked
+	FILE *file;
+	/// The string of the run which is currently merged
+	char *current;
+	/// The number of bytes in current
+	size_t current_length;
+	/// The allocated size of current
+	size_t current_capacity;
+	/// The number of occurrences of current with -c, otherwise 1
+	long int current_count;
+	/// Set if all strings of the run are merged
+	int exhausted;
+	/// The number of merges the strings of the run went through, 0 for a sorted chunk
+	int level;
+};
+
+/**
+ * A structure to represent a bucket of the radix sort which is still to be sorted.
+ */
+struct radix_bucket {
+	/// The index of the first string of the bucket
+	long int start;
+	/// The number of strings in the bucket
+	long int size;
+	/// The number of leading bytes which are equal for all strings of the bucket
+	size_t depth;
+};
+
 /* === Global Variables === */
 
 /** Name of the program **/
@@ -40,340 +220,2284 @@ static int fd1[2];
  */
 static int fd2[2]; 
 
-/** 
- * fd3[0] is used by the second child to read (redirected stdin);
- * fd3[1] is used by the parent to write to the redirected stdin of the second child
- */
-static int fd3[2];
+/** 
+ * fd3[0] is used by the second child to read (redirected stdin);
+ * fd3[1] is used by the parent to write to the redirected stdin of the second child
+ */
+static int fd3[2];
+
+/** 
+ * fd4[0] is used by the parent to read from the redirected stdout of the second child;
+ * fd4[1] is used by the second child to write (redirected stdout) 
+ */
+static int fd4[2];
+
+/** The bytes of the read strings **/
+static struct arena arena;
+
+/** The read strings **/
+static struct string *strings;
+
+/** The bytes the offsets of the strings refer to, either the arena or the mapped input file **/
+static const char *bytes;
+
+/** The number of bytes the offsets of the strings may refer to **/
+static size_t bytes_size;
+
+/** The file given with -f, NULL if the strings are read from stdin **/
+static const char *input_file = NULL;
+
+/** The mapped input file **/
+static char *mapping = MAP_FAILED;
+
+/** The size of the input file **/
+static size_t mapping_size;
+
+/** The first byte of the input file this process has to sort **/
+static size_t range_begin = 0;
+
+/** The byte after the last one of the input file this process has to sort, SIZE_MAX for the end of the file **/
+static size_t range_end = SIZE_MAX;
+
+/** The communication with the first child **/
+static struct child child1;
+
+/** The communication with the second child **/
+static struct child child2;
+
+/** Set if this process was forked by forksort, i.e. reads and writes records or indexes instead of lines **/
+static int record_mode = 0;
+
+/** Set if the children are only forked and not executed again (-x) **/
+static int no_exec = 0;
+
+/** Set if parent and children have the same bytes, so children get and return indexes instead of records **/
+static int index_records = 0;
+
+/** The sort which is used to sort strings in memory (-a) **/
+static Engine engine = MERGE;
+
+/** The field which is compared (-k), counted from 1, 0 for the whole line **/
+static long int key_field = 0;
+
+/** The character which separates the fields (-t), -1 if fields are separated by blanks **/
+static int key_delimiter = -1;
+
+/** Set if the keys are compared as numbers (-n) **/
+static int numeric_order = 0;
+
+/** Set if the order is reversed (-r) **/
+static int reverse_order = 0;
+
+/** Set if any of -k, -t, -n or -r is given, so strings are not compared byte by byte **/
+static int custom_order = 0;
+
+/** Set if equal strings are printed once with their number of occurrences (-c); with -k the first line of each group **/
+static int count_mode = 0;
+
+/** The maximum number of bytes used for strings with -m, 0 if the memory is not bounded **/
+static size_t memory_budget = 0;
+
+/** The sorted runs written with -m **/
+static struct run runs[MAX_RUNS];
+
+/** The number of runs in runs **/
+static int runs_size = 0;
+
+/** Set if the strings are partitioned by key range instead of halved (-p) **/
+static int sample_sort = 0;
+
+/** The workers of the partitions with -p, one per worker **/
+static struct child *partitions = NULL;
+
+/** The number of workers in partitions **/
+static long int partitions_size = 0;
+
+/** Set if the children return their sorted strings through shared memory (-s) **/
+static int shared_results = 0;
+
+/** The shared memory where this process stores its sorted strings with -s, NULL if it prints them **/
+static struct string *results = NULL;
+
+/** The number of strings stored in results **/
+static long int results_size = 0;
+
+/** The shared memory where the children of this process store their sorted strings with -s **/
+static struct string *shared_region = MAP_FAILED;
+
+/** The size of shared_region in bytes **/
+static size_t shared_region_size = 0;
+
+/** The number of leaf processes this process may still use, UNBOUNDED_WORKERS if there is no limit **/
+static long int workers = UNBOUNDED_WORKERS;
+
+/** The output which is not written to stdout yet **/
+static char output[OUTPUT_BUFFER_SIZE];
+
+/** The number of bytes in output **/
+static size_t output_size = 0;
+
+/** The trace file given with -T, NULL if tracing is off **/
+static const char *trace_file = NULL;
+
+/** The file descriptor of the trace file, -1 if tracing is off **/
+static int trace_fd = -1;
+
+/** The depth of this process in the process tree, 0 for the first process **/
+static long int depth = 0;
+
+/** The time this process started, for the trace **/
+static long long int process_start = 0;
+
+/** The time spent reading from the children during the current merge, for the trace **/
+static long long int readback_time = 0;
+
+/* === Prototypes === */
+
+/**
+ * @brief Parses the command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @details Sets workers if the -j option is given. A worker count of 0 means one worker per online processor. Sets 
+ * input_file if the -f option is given and no_exec if the -x option is given. The -s option sets shared_results and 
+ * no_exec. The -a option selects the engine and the -m option sets memory_budget. The -p option sets sample_sort and 
+ * no_exec and clears shared_results again. The -T option opens the trace file. The -k, -t, -n, -r and -c options 
+ * select the order and counting; as the radix sort and the multikey quicksort only order bytes, a custom order uses 
+ * the merge sort.
+ */
+static void parse_args(int argc, char **argv);
+
+/**
+ * @brief Returns the time of the monotonic clock if tracing is on
+ * @return The time in nanoseconds, 0 if tracing is off
+ */
+static long long int trace_clock(void);
+
+/**
+ * @brief Appends one stage of this process to the trace file if tracing is on
+ * @param stage The name of the stage
+ * @param start The time the stage started, as returned by trace_clock
+ * @param duration The duration of the stage in nanoseconds
+ * @details Every stage is written with a single write to a file opened with O_APPEND, so the lines of concurrent 
+ * processes do not interleave.
+ */
+static void trace(const char *stage, long long int start, long long int duration);
+
+/**
+ * @brief Returns the number of online processors, at least 1
+ * @return The number of processors
+ */
+static long int online_processors(void);
+
+/**
+ * @brief Parses a non-negative number given as argument of an option
+ * @param arg The argument
+ * @param name The name of the argument for error messages
+ * @return The parsed number
+ */
+static long int parse_number(const char *arg, const char *name);
+
+/**
+ * @brief Parses a number of bytes given as argument of an option, optionally followed by K, M or G
+ * @param arg The argument
+ * @return The parsed number of bytes
+ */
+static size_t parse_size(const char *arg);
+
+/**
+ * @brief Reads the line containing the number of strings from stdin
+ * @return The number of strings
+ */
+static long int read_count(void);
+
+/**
+ * @brief Reads the number of strings and the strings from stdin into the arena
+ * @return The number of strings
+ */
+static long int read_input(void);
+
+/**
+ * @brief Sorts the input from stdin or the input file with bounded memory and prints it
+ * @details Reads strings into the arena until the memory budget is reached, then writes them as a sorted run to a 
+ * temporary file and starts over. If all strings fit, they are sorted and printed directly; otherwise all runs are 
+ * merged at the end.
+ */
+static void external_sort(void);
+
+/**
+ * @brief Sorts the strings in the arena and writes them as a new run to a temporary file
+ * @param strings_size The number of strings in the arena
+ * @details Runs are kept ordered from the oldest to the newest, so their levels never increase. Whenever the newest 
+ * level has MERGE_FAN_IN runs, they are merged into one run of the next level, which may in turn complete that 
+ * level. Only if MAX_RUNS runs are left even so, all of them are merged into one.
+ */
+static void spill_run(long int strings_size);
+
+/**
+ * @brief Merges the newest runs into one run of the next level, which takes their place
+ * @param first The first run to merge; all runs from it to the newest one are merged
+ */
+static void merge_newest_runs(int first);
+
+/**
+ * @brief Creates an unlinked temporary file
+ * @return The stream of the file
+ */
+static FILE *create_run_file(void);
+
+/**
+ * @brief Merges sorted runs with a loser tree
+ * @param first The first run to merge
+ * @param count The number of runs to merge, beginning with first
+ * @param output The file to which the merged strings are written as records, NULL to print them out as lines
+ * @details The loser tree keeps the index of the loser of every match, so finding the next smallest string costs 
+ * one comparison per level of the tree, i.e. log2(count), and only touches the path of the run which won.
+ */
+static void merge_runs(int first, int count, FILE *output);
+
+/**
+ * @brief Replays the matches of the loser tree on the path from a run to the root
+ * @param tree The loser tree, tree[0] holds the winner
+ * @param first The first run of the tree
+ * @param count The number of runs of the tree
+ * @param leaf The run, relative to first, whose string changed
+ */
+static void loser_tree_adjust(int *tree, int first, int count, int leaf);
+
+/**
+ * @brief Compares the current strings of two runs, exhausted runs are greater than all others
+ * @param a The first run
+ * @param b The second run
+ * @return Non-zero if the first run wins, i.e. its string has to be printed first
+ */
+static int run_wins(int a, int b);
+
+/**
+ * @brief Reads the next string of a run into run->current, or marks it exhausted
+ * @param run The run
+ */
+static void read_run(struct run *run);
+
+/**
+ * @brief Writes the string which won a merge of runs, collapsing it with the previous one with -c
+ * @param output The file to which the string is written as record, NULL to print it out
+ * @param pending The previous string, which is only written once a different string follows
+ * @param pending_capacity The allocated size of pending
+ * @param pending_length The number of bytes in pending
+ * @param pending_count The number of occurrences of pending, 0 if there is no previous string
+ * @param string The string which won
+ * @param length The number of bytes of string
+ * @param count The number of occurrences of string, 0 to write the previous string at the end of the merge
+ * @details The strings of a run are overwritten when the run advances, so the previous string is copied.
+ */
+static void merge_runs_output(FILE *output, char **pending, size_t *pending_capacity, size_t *pending_length, 
+	long int *pending_count, const char *string, size_t length, long int count);
+
+/**
+ * @brief Reads one record from a stream
+ * @param file The stream
+ * @param buffer The buffer where the string is stored, grown if necessary
+ * @param capacity The allocated size of buffer
+ * @param length The length of the read string
+ * @param count The number of occurrences of the string, which precedes the record with -c
+ * @return 1 if a record was read, 0 at the end of the stream
+ */
+static int read_record(FILE *file, char **buffer, size_t *capacity, size_t *length, long int *count);
+
+/**
+ * @brief Writes one record to a stream
+ * @param file The stream
+ * @param string The bytes of the string
+ * @param length The number of bytes
+ * @param count The number of occurrences of the string, which precedes the record with -c
+ */
+static void write_record(FILE *file, const char *string, size_t length, long int count);
+
+/**
+ * @brief Maps the input file and builds the index of the lines between range_begin and range_end
+ * @return The number of strings
+ */
+static long int map_input(void);
+
+/**
+ * @brief Sorts the given strings and prints them out to the stream using filedescriptor number 1
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @details Sorts the strings in memory if only one worker is left, otherwise forks two children and merges their 
+ * results.
+ */
+static void sort_strings(struct string *strings, long int strings_size);
+
+/**
+ * @brief Forks the process and redirects stdin and stdout of the child to the given pipes.
+ * @param child The structure which is filled with the state of the communication with the child
+ * @param in_pipe The pipe from which the child reads its strings (redirected stdin)
+ * @param out_pipe The pipe to which the child writes the sorted strings (redirected stdout)
+ * @param strings The strings which the child has to sort
+ * @param strings_size The number of strings which the child has to sort
+ * @param child_workers The number of workers the child may use
+ * @details The forked child will use redirected stdin and stdout and recall the forksort program from the beginning,
+ * or with -x directly continue with sort_strings. The parent only prepares the data for the child and returns 
+ * immediately, so that both children run concurrently.
+ */
+static void forked_child(struct child *child, int in_pipe[2], int out_pipe[2], struct string *strings, long int strings_size, long int child_workers);
+
+/**
+ * @brief Sorts the given strings with a sample sort over all workers and prints them
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @details Picks workers-1 splitters from a random sample, distributes the strings into one partition per worker by
+ * the splitters and forks one worker per partition. The sorted partitions are printed in order as soon as the 
+ * respective worker delivers them.
+ */
+static void sample_sort_strings(struct string *strings, long int strings_size);
+
+/**
+ * @brief Finds the partition of a string with a binary search over the splitters
+ * @param string The string
+ * @param splitters The sorted splitters
+ * @param splitters_size The number of splitters
+ * @return The number of splitters which are smaller than the string
+ */
+static long int find_partition(const struct string *string, const struct string *splitters, long int splitters_size);
+
+/**
+ * @brief Forks the process, where the child sorts the given strings into shared memory.
+ * @param child The structure which is filled with the state of the child
+ * @param strings The strings which the child has to sort
+ * @param strings_size The number of strings which the child has to sort
+ * @param child_workers The number of workers the child may use
+ * @param child_results The shared memory of strings_size strings where the child stores its sorted strings
+ * @details Used with -s. The child continues with sort_strings and terminates after its results are complete.
+ */
+static void forked_worker(struct child *child, struct string *strings, long int strings_size, long int child_workers, struct string *child_results);
+
+/**
+ * @brief Writes the strings to both children at the same time.
+ * @details The stdin pipes of both children are multiplexed with poll, so neither child waits for the other one. 
+ * A child only starts printing after it has read all of its strings, so the results are read afterwards by merge_sort.
+ */
+static void write_to_children(void);
+
+/**
+ * @brief Waits until the given child terminated and checks its exit status.
+ * @param child The child to wait for
+ */
+static void wait_for_child(struct child *child);
+
+/**
+ * @brief Performs the merge step of the mergesort algorithm on the sorted outputs of the two children.
+ * @param child1 the first child
+ * @param sub_strings1_size the number of strings sorted by the first child
+ * @param child2 the second child
+ * @param sub_strings2_size the number of strings sorted by the second child
+ * @details Only the current string of each child is held in memory. The smaller one is printed out to the stream 
+ * using filedescriptor number 1 and replaced by the next string of the same child, so the output starts as soon as 
+ * both children have printed their first string. With -c the children return every string once, so equal strings 
+ * of both children are printed once with the sum of their counts, and fewer strings than sorted may be returned.
+ */
+static void merge_sort(struct child *child1, long int sub_strings1_size, struct child *child2, long int sub_strings2_size);
+
+/**
+ * @brief Reads the next sorted record from a child into child->current.
+ * @param child The child to read from
+ * @return 1 if a string was read, 0 if the child returned all of its strings
+ * @details If the input file is mapped, the child sends the index of a string instead of its bytes.
+ */
+static int read_from_child(struct child *child);
+
+/**
+ * @brief Prints a string to the stream using filedescriptor number 1
+ * @param string The bytes of the string
+ * @param length The number of bytes
+ * @param count The number of occurrences of the string, only used with -c
+ * @details Prints a record in record_mode and a line otherwise. If the parent has the same bytes, records consist 
+ * of the index of the string. With -s the index is stored in results instead of being printed. With -c records are 
+ * preceded by the count and lines by the count in a column of COUNT_WIDTH.
+ */
+static void write_string(const char *string, size_t length, long int count);
+
+/**
+ * @brief Appends bytes to the output buffer
+ * @param data The bytes
+ * @param length The number of bytes
+ * @details If the bytes do not fit, the buffer and the bytes are written together with one writev, so a long string 
+ * is never copied.
+ */
+static void output_append(const void *data, size_t length);
+
+/**
+ * @brief Writes the output buffer to the stream using filedescriptor number 1
+ */
+static void output_flush(void);
+
+/**
+ * @brief Writes all given buffers, continuing after partial writes
+ * @param fd The file descriptor
+ * @param iov The buffers, which are modified
+ * @param iovcnt The number of buffers
+ */
+static void write_all(int fd, struct iovec *iov, int iovcnt);
+
+/**
+ * @brief Compares two strings in the order selected with -k, -t, -n and -r
+ * @param string1 The bytes of the first string
+ * @param length1 The number of bytes of the first string
+ * @param string2 The bytes of the second string
+ * @param length2 The number of bytes of the second string
+ * @return An integer less than, equal to, or greater than zero like strcmp
+ * @details With -c strings with equal keys are equal, so they are counted together; otherwise they are ordered by 
+ * all their bytes.
+ */
+static int compare_lines(const char *string1, size_t length1, const char *string2, size_t length2);
+
+/**
+ * @brief Finds the field of a string selected with -k and -t
+ * @param string The bytes of the string
+ * @param length The number of bytes
+ * @param key_length The number of bytes of the field
+ * @return The first byte of the field; an empty field at the end of the string if it has too few fields
+ */
+static const char *find_key(const char *string, size_t length, size_t *key_length);
+
+/**
+ * @brief Parses the number at the beginning of a field for -n
+ * @param key The bytes of the field
+ * @param length The number of bytes
+ * @return The number, 0 if the field does not begin with a number
+ * @details Accepts leading blanks, a minus sign, digits and a fraction after a decimal point.
+ */
+static double key_number(const char *key, size_t length);
+
+/**
+ * @brief Returns the number of strings at the beginning which are equal to the first one with -c
+ * @param strings The sorted strings
+ * @param strings_size The number of strings, at least 1
+ * @return The number of equal strings, always 1 without -c
+ */
+static long int count_equal(const struct string *strings, long int strings_size);
+
+/**
+ * @brief Compares two strings byte by byte
+ * @param string1 The bytes of the first string
+ * @param length1 The number of bytes of the first string
+ * @param string2 The bytes of the second string
+ * @param length2 The number of bytes of the second string
+ * @return An integer less than, equal to, or greater than zero like strcmp
+ */
+static int compare_bytes(const char *string1, size_t length1, const char *string2, size_t length2);
+
+/**
+ * @brief Sorts the given strings in memory and prints them out to the stream using filedescriptor number 1
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @details Used by the leaves of a bounded process tree, where forking again would cost more than it gains.
+ */
+static void leaf_sort(struct string *strings, long int strings_size);
+
+/**
+ * @brief Sorts the given strings in memory with the selected engine
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ */
+static void sort_in_memory(struct string *strings, long int strings_size);
+
+/**
+ * @brief Sorts strings with a stable top-down merge sort
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @param buffer Temporary memory for strings_size strings
+ */
+static void merge_sort_strings(struct string *strings, long int strings_size, struct string *buffer);
+
+/**
+ * @brief Sorts strings with a multikey quicksort (three-way radix quicksort)
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @param depth The number of leading bytes which are equal for all strings
+ * @details Partitions the strings by their byte at position depth into smaller, equal and greater ones. Only the 
+ * equal part continues with the next byte, so every byte of a common prefix is looked at once per partitioning step.
+ */
+static void multikey_quicksort(struct string *strings, long int strings_size, size_t depth);
+
+/**
+ * @brief Sorts strings with an MSD radix sort
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @param depth The number of leading bytes which are equal for all strings
+ * @param buffer Temporary memory for strings_size strings
+ * @details Distributes the strings into buckets by their byte at position depth and sorts every bucket by the next 
+ * byte. A prefix shared by all strings is skipped without distributing. Small buckets use the multikey quicksort. 
+ * The buckets still to sort are kept on a stack on the heap instead of recursing, as strings which share a long 
+ * prefix, but not all of it, would otherwise need one level of recursion per byte.
+ */
+static void radix_sort(struct string *strings, long int strings_size, size_t depth, struct string *buffer);
+
+/**
+ * @brief Sorts strings with insertion sort
+ * @param strings The strings to sort
+ * @param strings_size The number of strings
+ * @param depth The number of leading bytes which are equal for all strings
+ */
+static void insertion_sort(struct string *strings, long int strings_size, size_t depth);
+
+/**
+ * @brief Computes the length of the prefix which all given strings share after the given position
+ * @param strings The strings
+ * @param strings_size The number of strings
+ * @param depth The number of leading bytes which are known to be equal for all strings
+ * @return The number of further equal bytes
+ * @details Each string is read once, so a long common prefix is skipped in one pass instead of one pass per byte.
+ */
+static size_t common_prefix(const struct string *strings, long int strings_size, size_t depth);
+
+/**
+ * @brief Returns the byte of a string at the given position
+ * @param string The string
+ * @param depth The position
+ * @return The byte as unsigned value, or -1 if the string is shorter
+ */
+static int byte_at(const struct string *string, size_t depth);
+
+/**
+ * @brief Compares two strings of the arena for qsort
+ * @param a Pointer to the first struct string
+ * @param b Pointer to the second struct string
+ * @return An integer less than, equal to, or greater than zero like strcmp
+ */
+static int compare_strings(const void *a, const void *b);
+
+/**
+ * @brief Executes the forksort program in a child process
+ * @param child_workers The number of workers the child may use
+ * @param strings The strings the child has to sort
+ * @param strings_size The number of strings the child has to sort
+ */
+static void exec_forksort(long int child_workers, struct string *strings, long int strings_size);
+
+/**
+ * @brief Makes sure that the given number of bytes can be appended to the arena
+ * @param bytes The number of bytes
+ */
+static void arena_reserve(size_t bytes);
+
+/**
+ * @brief Reads one string and appends it to the arena as a record
+ * @param input The stream to read from
+ * @param string The string which is set to the location of the string in the arena
+ * @return 1 if a string was read, 0 at the end of the input
+ * @details Reads a record in record_mode and a line of any length otherwise.
+ */
+static int read_string(FILE *input, struct string *string);
+
+/**
+ * @brief terminate program on program error
+ * @param exitcode exit code
+ * @param fmt format string
+ */
+static void bail_out(int exitcode, const char *fmt, ...);
+
+/**
+ * @brief free allocated resources
+ */
+static void free_resources(void);
+
+/* === Implementations === */
+
+static void parse_args(int argc, char **argv){
+
+	progname = argv[0];
+
+	int opt;
+	while((opt = getopt(argc, argv, "j:f:a:m:T:k:t:nrcxspRB:E:D:")) != -1){
+		switch(opt){
+			//-R, -B, -E and -D are only used by forksort itself when executing a child
+			case 'R':
+				record_mode = 1;
+				break;
+			case 'D':
+				depth = parse_number(optarg, "depth");
+				break;
+			case 'B':
+				range_begin = parse_number(optarg, "range");
+				break;
+			case 'E':
+				range_end = parse_number(optarg, "range");
+				break;
+			case 'j':
+				workers = parse_number(optarg, "number of workers");
+				if(workers == 0){
+					workers = online_processors();
+				}
+				break;
+			case 'f':
+				input_file = optarg;
+				break;
+			case 'x':
+				no_exec = 1;
+				break;
+			case 's':
+				//the shared memory is created without a name, so only forked children can use it
+				shared_results = 1;
+				no_exec = 1;
+				break;
+			case 'a':
+				if(strcmp(optarg, "merge") == 0){
+					engine = MERGE;
+				}
+				else if(strcmp(optarg, "quick") == 0){
+					engine = QUICK;
+				}
+				else if(strcmp(optarg, "radix") == 0){
+					engine = RADIX;
+				}
+				else{
+					bail_out(EXIT_FAILURE, "Invalid engine: %s (use radix, merge or quick)", optarg);
+				}
+				break;
+			case 'm':
+				memory_budget = parse_size(optarg);
+				break;
+			case 'p':
+				//the workers use the partitions of the parent, so they are only forked
+				sample_sort = 1;
+				no_exec = 1;
+				break;
+			case 'T':
+				trace_file = optarg;
+				break;
+			case 'k':
+				key_field = parse_number(optarg, "field");
+				if(key_field == 0){
+					bail_out(EXIT_FAILURE, "Invalid field: %s (fields are counted from 1)", optarg);
+				}
+				custom_order = 1;
+				break;
+			case 't':
+				if(strlen(optarg) != 1){
+					bail_out(EXIT_FAILURE, "Invalid delimiter: %s (use a single character)", optarg);
+				}
+				key_delimiter = (unsigned char) optarg[0];
+				custom_order = 1;
+				break;
+			case 'n':
+				numeric_order = 1;
+				custom_order = 1;
+				break;
+			case 'r':
+				reverse_order = 1;
+				custom_order = 1;
+				break;
+			case 'c':
+				count_mode = 1;
+				break;
+			default:
+				bail_out(EXIT_FAILURE, "Usage: %s [-x] [-s] [-p] [-c] [-n] [-r] [-k field] [-t delimiter] [-j workers] [-a radix|merge|quick] [-m memory] [-T trace] [-f file]", progname);
+		}
+	}
+	//check there are no positional arguments
+	if(optind != argc){
+		bail_out(EXIT_FAILURE, "Usage: %s [-x] [-s] [-p] [-c] [-n] [-r] [-k field] [-t delimiter] [-j workers] [-a radix|merge|quick] [-m memory] [-T trace] [-f file]", progname);
+	}
+	//a sample sort needs a fixed number of partitions
+	if(sample_sort && workers == UNBOUNDED_WORKERS){
+		workers = online_processors();
+	}
+	index_records = (input_file != NULL || no_exec);
+	//the radix sort and the multikey quicksort only know the order of bytes
+	if(custom_order){
+		engine = MERGE;
+	}
+	//the number of strings a child returns with -c is only known when it is done, and the partition workers of a
+	//sample sort always send their records through pipes, so the results use pipes
+	if(count_mode || sample_sort){
+		shared_results = 0;
+	}
+	if(trace_file != NULL){
+		//only the first process starts a new trace, executed children append to it
+		int flags = O_WRONLY|O_CREAT|O_APPEND|(record_mode ? 0 : O_TRUNC);
+		trace_fd = open(trace_file, flags, 0644);
+		if(trace_fd<0){
+			bail_out(EXIT_FAILURE, "open %s", trace_file);
+		}
+		//executed children open the file again
+		(void) fcntl(trace_fd, F_SETFD, FD_CLOEXEC);
+		if(!record_mode && write(trace_fd, TRACE_HEADER, strlen(TRACE_HEADER))<0){
+			bail_out(EXIT_FAILURE, "write %s", trace_file);
+		}
+		process_start = trace_clock();
+	}
+	errno = 0;
+}
+
+static long long int trace_clock(void){
+
+	if(trace_fd<0){
+		return 0;
+	}
+	struct timespec now;
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000000000LL + now.tv_nsec;
+}
+
+static void trace(const char *stage, long long int start, long long int duration){
+
+	if(trace_fd<0){
+		return;
+	}
+	char line[128];
+	int length = snprintf(line, sizeof(line), "%ld,%ld,%ld,%s,%lld,%lld\n", (long int) getpid(), 
+		(long int) getppid(), depth, stage, start, duration);
+	//a lost line must not fail the sort
+	(void) write(trace_fd, line, length);
+}
+
+static long int online_processors(void){
+
+	long int processors = sysconf(_SC_NPROCESSORS_ONLN);
+	if(processors < 1){
+		processors = 1;
+	}
+	return processors;
+}
+
+static long int parse_number(const char *arg, const char *name){
+
+	char *endptr;
+	errno = 0;
+	long int number = strtol(arg, &endptr, 10);
+	if(errno != 0 || endptr == arg || *endptr != '\0' || number < 0){
+		bail_out(EXIT_FAILURE, "Invalid %s: %s", name, arg);
+	}
+	return number;
+}
+
+static size_t parse_size(const char *arg){
+
+	char *endptr;
+	errno = 0;
+	unsigned long long int size = strtoull(arg, &endptr, 10);
+	if(errno != 0 || endptr == arg){
+		bail_out(EXIT_FAILURE, "Invalid memory size: %s", arg);
+	}
+	switch(*endptr){
+		case 'G':
+			size *= 1024;
+			//fall through
+		case 'M':
+			size *= 1024;
+			//fall through
+		case 'K':
+			size *= 1024;
+			endptr++;
+			break;
+		default:
+			break;
+	}
+	if(*endptr != '\0' || size == 0 || size > SIZE_MAX){
+		bail_out(EXIT_FAILURE, "Invalid memory size: %s", arg);
+	}
+	return size;
+}
+
+/**
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ * @details Reads the strings from stdin or the input file, then sorts them in memory or forks two children
+ */
+int main(int argc, char **argv){
+
+	parse_args(argc, argv);
+
+	if(memory_budget > 0){
+		external_sort();
+		output_flush();
+		free_resources();
+		return EXIT_SUCCESS;
+	}
+
+	long int num_of_elements;
+	long long int start = trace_clock();
+	if(input_file != NULL){
+		num_of_elements = map_input();
+	}
+	else{
+		num_of_elements = read_input();
+	}
+	trace("read", start, trace_clock()-start);
+
+	//an empty input file has nothing to sort
+	if(num_of_elements > 0){
+		sort_strings(strings, num_of_elements);
+	}
+
+	output_flush();
+	free_resources();
+	return EXIT_SUCCESS;
+}
+
+static void sort_strings(struct string *strings, long int strings_size){
+
+	if(strings_size == 1){
+		write_string(bytes+strings[0].offset, strings[0].length, 1);
+	}
+	else if(workers == 1){
+		leaf_sort(strings, strings_size);
+	}
+	else if(sample_sort){
+		sample_sort_strings(strings, strings_size);
+	}
+	else if(shared_results){
+		//one region for both children, each child fills its half
+		shared_region_size = strings_size*sizeof(struct string);
+		shared_region = mmap(NULL, shared_region_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+		if(shared_region == MAP_FAILED){
+			bail_out(EXIT_FAILURE, "mmap");
+		}
+		forked_worker(&child1, strings, strings_size/2, workers/2, shared_region);
+		forked_worker(&child2, strings+strings_size/2, strings_size-strings_size/2, workers-workers/2, shared_region+strings_size/2);
+
+		//the results are complete once the children terminated
+		wait_for_child(&child1);
+		wait_for_child(&child2);
+		merge_sort(&child1, strings_size/2, &child2, strings_size-strings_size/2);
+		(void) munmap(shared_region, shared_region_size);
+		shared_region = MAP_FAILED;
+	}
+	else{
+		//create 4 unnamed pipes for reading and writing
+		if(pipe(fd1)<0 || pipe(fd2)<0 || pipe(fd3)<0 || pipe(fd4)<0){
+			bail_out(EXIT_FAILURE, "pipe");
+		}
+		//fork both children before talking to either of them
+		forked_child(&child1, fd1, fd2, strings, strings_size/2, workers/2);
+		forked_child(&child2, fd3, fd4, strings+strings_size/2, strings_size-strings_size/2, workers-workers/2);
+		//with -x and -f the children already have their input, so nothing is written
+		if(child1.write_fd >= 0 || child2.write_fd >= 0){
+			long long int start = trace_clock();
+			write_to_children();
+			trace("write", start, trace_clock()-start);
+		}
+
+		//merge the results while the children are still printing them
+		merge_sort(&child1, strings_size/2, &child2, strings_size-strings_size/2);
+		wait_for_child(&child1);
+		wait_for_child(&child2);
+	}
+}
+
+static long int read_count(void){
+
+	//parse the number of strings
+	char num_of_elements_str[MAX_LENGTH];
+	if((fgets(num_of_elements_str, MAX_LENGTH, stdin))==NULL){
+		bail_out(EXIT_FAILURE, "fgets");
+	}
+	
+	char *endptr;
+	long int num_of_elements = strtol(num_of_elements_str ,&endptr, 10);
+
+	if((errno == ERANGE && (num_of_elements == LONG_MAX || num_of_elements == LONG_MIN)) || errno != 0){
+		bail_out(EXIT_FAILURE, "strtol");
+	}
+
+	if (endptr == num_of_elements_str){
+		bail_out(EXIT_FAILURE, "No digits were found");
+	}
+
+	if(*endptr != '\n'){
+		bail_out(EXIT_FAILURE, "Further characters after number found: %s", endptr);
+	}
+
+	if(num_of_elements<1){
+		bail_out(EXIT_FAILURE, "Number of elements has to be greater than 0");
+	}
+	return num_of_elements;
+}
+
+static long int read_input(void){
+
+	long int num_of_elements = read_count();
+
+	//read the strings
+	strings = malloc(num_of_elements * sizeof(struct string));
+	if(strings == NULL){
+		bail_out(EXIT_FAILURE, "malloc");
+	}
+	long int count = 0;
+	while(count<num_of_elements){
+		if(!read_string(stdin, &strings[count])){
+			bail_out(EXIT_FAILURE, "Found only %ld of %ld strings", count, num_of_elements);
+		}
+		count++;
+	}
+	//the arena does not grow anymore, so its bytes do not move
+	bytes = arena.data;
+	bytes_size = arena.size;
+	return num_of_elements;
+}
+
+static void external_sort(void){
+
+	FILE *input = stdin;
+	long int num_of_elements = -1;
+	if(input_file != NULL){
+		input = fopen(input_file, "r");
+		if(input == NULL){
+			bail_out(EXIT_FAILURE, "fopen %s", input_file);
+		}
+	}
+	else{
+		num_of_elements = read_count();
+	}
+
+	long int strings_capacity = 0;
+	long int strings_size = 0;
+	long int count = 0;
+	while(num_of_elements < 0 || count < num_of_elements){
+		//the index of every string needs room twice, for the strings and the buffer of the sort
+		size_t used = arena.size + (strings_size+1)*2*sizeof(struct string);
+		if(strings_size > 0 && used+MAX_LENGTH > memory_budget){
+			spill_run(strings_size);
+			strings_size = 0;
+		}
+		if(strings_size == strings_capacity){
+			strings_capacity = strings_capacity*2 + 1024;
+			struct string *grown = realloc(strings, strings_capacity*sizeof(struct string));
+			if(grown == NULL){
+				bail_out(EXIT_FAILURE, "realloc");
+			}
+			strings = grown;
+		}
+		if(!read_string(input, &strings[strings_size])){
+			if(num_of_elements >= 0){
+				bail_out(EXIT_FAILURE, "Found only %ld of %ld strings", count, num_of_elements);
+			}
+			break;
+		}
+		strings_size++;
+		count++;
+	}
+	if(input != stdin){
+		(void) fclose(input);
+	}
+
+	bytes = arena.data;
+	bytes_size = arena.size;
+	if(runs_size == 0){
+		//everything fit into memory
+		leaf_sort(strings, strings_size);
+		return;
+	}
+	if(strings_size > 0){
+		spill_run(strings_size);
+	}
+	//the strings are written, the memory is needed for the merge
+	free(strings);
+	strings = NULL;
+	free(arena.data);
+	(void) memset(&arena, 0, sizeof(arena));
+	merge_runs(0, runs_size, NULL);
+}
+
+static void spill_run(long int strings_size){
+
+	//the runs of all levels only fill the array after about MERGE_FAN_IN^(MAX_RUNS/(MERGE_FAN_IN-1)) chunks
+	if(runs_size == MAX_RUNS){
+		merge_newest_runs(0);
+	}
+
+	bytes = arena.data;
+	bytes_size = arena.size;
+	sort_in_memory(strings, strings_size);
+
+	long long int start = trace_clock();
+	FILE *file = create_run_file();
+	for(long int i=0; i<strings_size; ){
+		long int count = count_equal(strings+i, strings_size-i);
+		write_record(file, bytes+strings[i].offset, strings[i].length, count);
+		i += count;
+	}
+	if(fflush(file) != 0 || fseek(file, 0, SEEK_SET) != 0){
+		bail_out(EXIT_FAILURE, "writing run");
+	}
+	trace("spill", start, trace_clock()-start);
+	runs[runs_size].file = file;
+	runs[runs_size].level = 0;
+	runs_size++;
+
+	//a complete level is merged right away, while its runs are still few and small
+	while(1){
+		int level = runs[runs_size-1].level;
+		int first = runs_size-1;
+		while(first > 0 && runs[first-1].level == level){
+			first--;
+		}
+		if(runs_size-first < MERGE_FAN_IN){
+			break;
+		}
+		merge_newest_runs(first);
+	}
+
+	//the next chunk reuses the arena
+	arena.size = 0;
+}
+
+static void merge_newest_runs(int first){
+
+	int level = 0;
+	for(int i=first; i<runs_size; i++){
+		if(runs[i].level > level){
+			level = runs[i].level;
+		}
+	}
+	FILE *file = create_run_file();
+	merge_runs(first, runs_size-first, file);
+	runs[first].file = file;
+	runs[first].level = level+1;
+	runs_size = first+1;
+}
+
+static FILE *create_run_file(void){
+
+	const char *directory = getenv("TMPDIR");
+	if(directory == NULL || *directory == '\0'){
+		directory = "/tmp";
+	}
+	char *name = malloc(strlen(directory)+1+strlen(RUN_FILE_NAME)+1);
+	if(name == NULL){
+		bail_out(EXIT_FAILURE, "malloc");
+	}
+	(void) sprintf(name, "%s/%s", directory, RUN_FILE_NAME);
+	int fd = mkstemp(name);
+	if(fd < 0){
+		free(name);
+		bail_out(EXIT_FAILURE, "mkstemp");
+	}
+	//the file is removed as soon as it is closed, even if forksort fails
+	(void) unlink(name);
+	free(name);
+
+	FILE *file = fdopen(fd, "w+");
+	if(file == NULL){
+		(void) close(fd);
+		bail_out(EXIT_FAILURE, "fdopen");
+	}
+	(void) setvbuf(file, NULL, _IOFBF, RUN_BUFFER_SIZE);
+	return file;
+}
+
+static void merge_runs(int first, int count, FILE *output){
+
+	long long int start = trace_clock();
+	int *tree = malloc(count*sizeof(int));
+	if(tree == NULL){
+		bail_out(EXIT_FAILURE, "malloc");
+	}
+	for(int i=0; i<count; i++){
+		tree[i] = -1;
+		runs[first+i].exhausted = 0;
+		read_run(&runs[first+i]);
+	}
+	//-1 stands for a run which wins against every other one, so it is replaced while the tree is built
+	for(int i=count-1; i>=0; i--){
+		loser_tree_adjust(tree, first, count, i);
+	}
+
+	char *pending = NULL;
+	size_t pending_capacity = 0;
+	size_t pending_length = 0;
+	long int pending_count = 0;
+	while(!runs[first+tree[0]].exhausted){
+		struct run *winner = &runs[first+tree[0]];
+		merge_runs_output(output, &pending, &pending_capacity, &pending_length, &pending_count, winner->current, 
+			winner->current_length, winner->current_count);
+		read_run(winner);
+		loser_tree_adjust(tree, first, count, tree[0]);
+	}
+	merge_runs_output(output, &pending, &pending_capacity, &pending_length, &pending_count, NULL, 0, 0);
+	free(pending);
+	free(tree);
+
+	for(int i=0; i<count; i++){
+		(void) fclose(runs[first+i].file);
+		free(runs[first+i].current);
+		(void) memset(&runs[first+i], 0, sizeof(struct run));
+	}
+	if(output != NULL && (fflush(output) != 0 || fseek(output, 0, SEEK_SET) != 0)){
+		bail_out(EXIT_FAILURE, "writing run");
+	}
+	trace("merge", start, trace_clock()-start);
+}
+
+static void merge_runs_output(FILE *output, char **pending, size_t *pending_capacity, size_t *pending_length, 
+	long int *pending_count, const char *string, size_t length, long int count){
+
+	//the bytes of an empty string may be NULL, so the end of the merge is marked by the count
+	if(!count_mode){
+		if(count == 0){
+			return;
+		}
+		if(output == NULL){
+			write_string(string, length, count);
+		}
+		else{
+			write_record(output, string, length, count);
+		}
+		return;
+	}
+	//the runs are sorted and contain every string once, so equal strings of different runs win one after another
+	if(count > 0 && *pending_count > 0 && compare_lines(*pending, *pending_length, string, length) == 0){
+		*pending_count += count;
+		return;
+	}
+	if(*pending_count > 0){
+		if(output == NULL){
+			write_string(*pending, *pending_length, *pending_count);
+		}
+		else{
+			write_record(output, *pending, *pending_length, *pending_count);
+		}
+	}
+	if(count == 0){
+		return;
+	}
+	if(length > *pending_capacity){
+		char *grown = realloc(*pending, length);
+		if(grown == NULL){
+			bail_out(EXIT_FAILURE, "realloc");
+		}
+		*pending = grown;
+		*pending_capacity = length;
+	}
+	(void) memcpy(*pending, string, length);
+	*pending_length = length;
+	*pending_count = count;
+}
+
+static void loser_tree_adjust(int *tree, int first, int count, int leaf){
+
+	//the leaves are the positions count to 2*count-1 of the tree, the parent of position i is i/2
+	int winner = leaf;
+	for(int node=(leaf+count)/2; node>0; node/=2){
+		int loser = tree[node];
+		if(loser == -1 || (winner != -1 && run_wins(first+loser, first+winner))){
+			tree[node] = winner;
+			winner = loser;
+		}
+	}
+	tree[0] = winner;
+}
+
+static int run_wins(int a, int b){
+
+	if(runs[a].exhausted || runs[b].exhausted){
+		return runs[b].exhausted && (!runs[a].exhausted || a < b);
+	}
+	int result = compare_lines(runs[a].current, runs[a].current_length, runs[b].current, runs[b].current_length);
+	//equal strings keep the order of the runs
+	return result < 0 || (result == 0 && a < b);
+}
+
+static void read_run(struct run *run){
+
+	if(!read_record(run->file, &run->current, &run->current_capacity, &run->current_length, &run->current_count)){
+		run->exhausted = 1;
+	}
+}
+
+static int read_record(FILE *file, char **buffer, size_t *capacity, size_t *length, long int *count){
+
+	*count = 1;
+	if(count_mode && fread(count, sizeof(long int), 1, file) != 1){
+		return 0;
+	}
+	uint32_t record_length;
+	if(fread(&record_length, RECORD_HEADER_SIZE, 1, file) != 1){
+		if(count_mode){
+			bail_out(EXIT_FAILURE, "truncated record");
+		}
+		return 0;
+	}
+	if(record_length > *capacity){
+		char *grown = realloc(*buffer, record_length);
+		if(grown == NULL){
+			bail_out(EXIT_FAILURE, "realloc");
+		}
+		*buffer = grown;
+		*capacity = record_length;
+	}
+	if(record_length > 0 && fread(*buffer, record_length, 1, file) != 1){
+		bail_out(EXIT_FAILURE, "truncated record");
+	}
+	*length = record_length;
+	return 1;
+}
+
+static void write_record(FILE *file, const char *string, size_t length, long int count){
+
+	if(count_mode && fwrite(&count, sizeof(long int), 1, file) != 1){
+		bail_out(EXIT_FAILURE, "fwrite");
+	}
+	uint32_t record_length = length;
+	if(fwrite(&record_length, RECORD_HEADER_SIZE, 1, file) != 1 || fwrite(string, 1, length, file) != length){
+		bail_out(EXIT_FAILURE, "fwrite");
+	}
+}
+
+static long int map_input(void){
+
+	int fd = open(input_file, O_RDONLY);
+	if(fd<0){
+		bail_out(EXIT_FAILURE, "open %s", input_file);
+	}
+	struct stat st;
+	if(fstat(fd, &st)<0){
+		(void) close(fd);
+		bail_out(EXIT_FAILURE, "fstat");
+	}
+	mapping_size = st.st_size;
+	if(range_end > mapping_size){
+		range_end = mapping_size;
+	}
+	if(range_begin >= range_end){
+		(void) close(fd);
+		return 0;
+	}
+	mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close(fd);
+	if(mapping == MAP_FAILED){
+		bail_out(EXIT_FAILURE, "mmap");
+	}
+	bytes = mapping;
+	bytes_size = mapping_size;
+
+	//count the lines first, so the index is allocated only once
+	long int num_of_elements = 0;
+	const char *position = mapping+range_begin;
+	const char *end = mapping+range_end;
+	while(position < end){
+		const char *newline = memchr(position, '\n', end-position);
+		num_of_elements++;
+		position = (newline == NULL) ? end : newline+1;
+	}
+
+	strings = malloc(num_of_elements * sizeof(struct string));
+	if(strings == NULL){
+		bail_out(EXIT_FAILURE, "malloc");
+	}
+	position = mapping+range_begin;
+	for(long int i=0; i<num_of_elements; i++){
+		const char *newline = memchr(position, '\n', end-position);
+		strings[i].offset = position-mapping;
+		strings[i].length = ((newline == NULL) ? end : newline)-position;
+		position = (newline == NULL) ? end : newline+1;
+	}
+	return num_of_elements;
+}
+
+static void forked_child(struct child *child, int in_pipe[2], int out_pipe[2], struct string *strings, long int strings_size, long int child_workers){
+
+	if(!index_records){
+		//the strings of one half are still stored one after another in the arena, so they are written from there
+		(void) sprintf(child->header, "%li\n", strings_size);
+		child->header_size = strlen(child->header);
+		child->input = bytes+strings[0].offset-RECORD_HEADER_SIZE;
+		child->input_size = strings[strings_size-1].offset+strings[strings_size-1].length-(strings[0].offset-RECORD_HEADER_SIZE);
+		child->written = 0;
+	}
+
+	//the child must not print what is still buffered for the parent
+	output_flush();
+	long long int start = trace_clock();
+	pid_t pid = fork();
+
+	if(pid==0){
+		depth++;
+		process_start = trace_clock();
+		//redirect stdin and stdout to the file descriptors
+		if(dup2(in_pipe[0], fileno(stdin))<0){
+			bail_out(EXIT_FAILURE, "dup2");
+		}
+		if(dup2(out_pipe[1], fileno(stdout))<0){
+			bail_out(EXIT_FAILURE, "dup2");
+		}
+		//close all endpoints, including the ones of the sibling which is forked before this child
+		(void) close(fd1[0]);
+		(void) close(fd1[1]);
+		(void) close(fd2[0]);
+		(void) close(fd2[1]);
+		(void) close(fd3[0]);
+		(void) close(fd3[1]);
+		(void) close(fd4[0]);
+		(void) close(fd4[1]);
+		if(!no_exec){
+			exec_forksort(child_workers, strings, strings_size);
+		}
+
+		//continue as a forksort process which got its strings from the parent
+		(void) memset(&child1, 0, sizeof(child1));
+		(void) memset(&child2, 0, sizeof(child2));
+		record_mode = 1;
+		workers = child_workers;
+		sort_strings(strings, strings_size);
+		output_flush();
+		free_resources();
+		exit(EXIT_SUCCESS);
+	}
+	else if(pid>0){
+		trace("fork", start, trace_clock()-start);
+		//close unused endpoints
+		(void) close(in_pipe[0]);
+		(void) close(out_pipe[1]);
+		child->pid = pid;
+		child->write_fd = in_pipe[1];
+		child->read_fd = out_pipe[0];
+		if(index_records){
+			//the child maps the input file itself or already has the strings
+			(void) close(child->write_fd);
+			child->write_fd = -1;
+			return;
+		}
+		//the parent must never block on a single child while the other one waits for it
+		if(fcntl(child->write_fd, F_SETFL, fcntl(child->write_fd, F_GETFL) | O_NONBLOCK)<0){
+			bail_out(EXIT_FAILURE, "fcntl");
+		}
+	}
+	else{
+		bail_out(EXIT_FAILURE, "fork");
+	}
+}
+
+static void sample_sort_strings(struct string *strings, long int strings_size){
+
+	long int workers_size = workers;
+	if(workers_size > strings_size){
+		workers_size = strings_size;
+	}
+	long long int start = trace_clock();
+
+	//sort a random sample and take equally spaced splitters from it
+	long int sample_size = workers_size*SAMPLES_PER_WORKER;
+	struct string *sample = malloc(sample_size*sizeof(struct string));
+	struct string *splitters = malloc((workers_size-1)*sizeof(struct string));
+	long int *partition_sizes = calloc(workers_size, sizeof(long int));
+	long int *positions = malloc(workers_size*sizeof(long int));
+	long int *partition_of = malloc(strings_size*sizeof(long int));
+	struct string *partitioned = malloc(strings_size*sizeof(struct string));
+	partitions = calloc(workers_size, sizeof(struct child));
+	if(sample == NULL || splitters == NULL || partition_sizes == NULL || positions == NULL || partition_of == NULL || 
+			partitioned == NULL || partitions == NULL){
+		bail_out(EXIT_FAILURE, "malloc");
+	}
+	partitions_size = workers_size;
+	//xorshift with a fixed seed, so a run can be repeated
+	uint64_t random = 88172645463325252ULL ^ (uint64_t) strings_size;
+	for(long int i=0; i<sample_size; i++){
+		random ^= random << 13;
+		random ^= random >> 7;
+		random ^= random << 17;
+		sample[i] = strings[random % strings_size];
+	}
+	sort_in_memory(sample, sample_size);
+	for(long int i=1; i<workers_size; i++){
+		splitters[i-1] = sample[i*sample_size/workers_size];
+	}
+	free(sample);
+
+	//distribute the strings into the partitions, keeping their order within a partition
+	for(long int i=0; i<strings_size; i++){
+		partition_of[i] = find_partition(&strings[i], splitters, workers_size-1);
+		partition_sizes[partition_of[i]]++;
+	}
+	positions[0] = 0;
+	for(long int p=1; p<workers_size; p++){
+		positions[p] = positions[p-1]+partition_sizes[p-1];
+	}
+	for(long int i=0; i<strings_size; i++){
+		partitioned[positions[partition_of[i]]++] = strings[i];
+	}
+	free(splitters);
+	free(partition_of);
+	free(positions);
+	trace("partition", start, trace_clock()-start);
+
+	//start all workers before printing, so every partition is sorted concurrently
+	long int first = 0;
+	for(long int p=0; p<workers_size; p++){
+		int fd[2];
+		if(pipe(fd)<0){
+			bail_out(EXIT_FAILURE, "pipe");
+		}
+		output_flush();
+		start = trace_clock();
+		pid_t pid = fork();
+		if(pid==0){
+			depth++;
+			process_start = trace_clock();
+			if(dup2(fd[1], fileno(stdout))<0){
+				bail_out(EXIT_FAILURE, "dup2");
+			}
+			(void) close(fd[0]);
+			(void) close(fd[1]);
+			//the read ends of the workers forked before belong to the parent
+			for(long int q=0; q<p; q++){
+				(void) close(partitions[q].read_fd);
+			}
+			free(partitions);
+			partitions = NULL;
+			partitions_size = 0;
+			record_mode = 1;
+			workers = 1;
+			leaf_sort(partitioned+first, partition_sizes[p]);
+			output_flush();
+			free(partitioned);
+			free(partition_sizes);
+			free_resources();
+			exit(EXIT_SUCCESS);
+		}
+		else if(pid<0){
+			bail_out(EXIT_FAILURE, "fork");
+		}
+		trace("fork", start, trace_clock()-start);
+		(void) close(fd[1]);
+		partitions[p].pid = pid;
+		partitions[p].write_fd = -1;
+		partitions[p].read_fd = fd[0];
+		first += partition_sizes[p];
+	}
+	free(partitioned);
+
+	//the partitions are in order, so they are printed one after another
+	for(long int p=0; p<workers_size; p++){
+		struct child *partition = &partitions[p];
+		partition->output = fdopen(partition->read_fd, "r");
+		if(partition->output == NULL){
+			bail_out(EXIT_FAILURE, "fdopen");
+		}
+		start = trace_clock();
+		readback_time = 0;
+		//the partitions have disjoint keys, so with -c there is nothing to collapse between them
+		while(read_from_child(partition)){
+			write_string(partition->current, partition->current_length, partition->current_count);
+		}
+		trace("readback", start, readback_time);
+		(void) fclose(partition->output);
+		partition->output = NULL;
+		partition->read_fd = -1;
+		wait_for_child(partition);
+	}
+	free(partition_sizes);
+}
+
+static long int find_partition(const struct string *string, const struct string *splitters, long int splitters_size){
+
+	long int low = 0;
+	long int high = splitters_size;
+	while(low < high){
+		long int middle = low+(high-low)/2;
+		if(compare_strings(&splitters[middle], string) < 0){
+			low = middle+1;
+		}
+		else{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+static void forked_worker(struct child *child, struct string *strings, long int strings_size, long int child_workers, struct string *child_results){
+
+	output_flush();
+	long long int start = trace_clock();
+	pid_t pid = fork();
+
+	if(pid==0){
+		depth++;
+		process_start = trace_clock();
+		//continue as a forksort process which got its strings from the parent
+		(void) memset(&child1, 0, sizeof(child1));
+		(void) memset(&child2, 0, sizeof(child2));
+		shared_region = MAP_FAILED;
+		results = child_results;
+		results_size = 0;
+		workers = child_workers;
+		sort_strings(strings, strings_size);
+		if(results_size != strings_size){
+			bail_out(EXIT_FAILURE, "stored %ld of %ld strings", results_size, strings_size);
+		}
+		free_resources();
+		exit(EXIT_SUCCESS);
+	}
+	else if(pid>0){
+		trace("fork", start, trace_clock()-start);
+		child->pid = pid;
+		child->write_fd = -1;
+		child->read_fd = -1;
+		child->results = child_results;
+		child->results_size = strings_size;
+		child->results_read = 0;
+	}
+	else{
+		bail_out(EXIT_FAILURE, "fork");
+	}
+}
+
+static void write_to_children(void){
+
+	struct child *children[] = {&child1, &child2};
+
+	while(child1.write_fd >= 0 || child2.write_fd >= 0){
+		//negative file descriptors are ignored by poll
+		struct pollfd fds[2];
+		for(int i=0; i<2; i++){
+			fds[i].fd = children[i]->write_fd;
+			fds[i].events = POLLOUT;
+		}
+		if(poll(fds, 2, -1)<0){
+			if(errno == EINTR){
+				errno = 0;
+				continue;
+			}
+			bail_out(EXIT_FAILURE, "poll");
+		}
+
+		for(int i=0; i<2; i++){
+			struct child *child = children[i];
+			if(fds[i].fd < 0 || fds[i].revents == 0){
+				continue;
+			}
+			//write the rest of the header and the strings with one system call
+			struct iovec iov[2];
+			int iovcnt = 0;
+			if(child->written < child->header_size){
+				iov[iovcnt].iov_base = child->header+child->written;
+				iov[iovcnt].iov_len = child->header_size-child->written;
+				iovcnt++;
+				iov[iovcnt].iov_base = (void *) child->input;
+				iov[iovcnt].iov_len = child->input_size;
+				iovcnt++;
+			}
+			else{
+				iov[iovcnt].iov_base = (void *) (child->input+(child->written-child->header_size));
+				iov[iovcnt].iov_len = child->header_size+child->input_size-child->written;
+				iovcnt++;
+			}
+			ssize_t written = writev(child->write_fd, iov, iovcnt);
+			if(written<0){
+				if(errno != EAGAIN && errno != EINTR){
+					bail_out(EXIT_FAILURE, "writev");
+				}
+				errno = 0;
+			}
+			else{
+				child->written += written;
+			}
+			if(child->written == child->header_size+child->input_size){
+				(void) close(child->write_fd);
+				child->write_fd = -1;
+			}
+		}
+	}
+}
+
+static void wait_for_child(struct child *child){
+
+	int status;
+	long long int start = trace_clock();
+	while(waitpid(child->pid, &status, 0)<0){
+		if(errno != EINTR){
+			bail_out(EXIT_FAILURE, "waitpid");
+		}
+		errno = 0;
+	}
+	trace("wait", start, trace_clock()-start);
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS){
+		bail_out(EXIT_FAILURE, "child %ld failed", (long int) child->pid);
+	}
+}
+
+static void merge_sort(struct child *child1, long int sub_strings1_size, struct child *child2, long int sub_strings2_size){
+
+	long int i = 0;
+	long int j = 0;
+	long long int start = trace_clock();
+	readback_time = 0;
+
+	if(!shared_results){
+		child1->output = fdopen(child1->read_fd, "r");
+		child2->output = fdopen(child2->read_fd, "r");
+		if(child1->output == NULL || child2->output == NULL){
+			bail_out(EXIT_FAILURE, "fdopen");
+		}
+	}
+
+	int more1 = read_from_child(child1);
+	int more2 = read_from_child(child2);
+	while(more1 && more2){
+		int result = compare_lines(child1->current, child1->current_length, child2->current, child2->current_length);
+		if(result == 0 && count_mode){
+			//each child returned the string once, so it is printed once for both
+			write_string(child1->current, child1->current_length, child1->current_count+child2->current_count);
+			i++;
+			j++;
+			more1 = read_from_child(child1);
+			more2 = read_from_child(child2);
+		}
+		else if(result<0){
+			write_string(child1->current, child1->current_length, child1->current_count);
+			i++;
+			more1 = read_from_child(child1);
+		}
+		else{
+			write_string(child2->current, child2->current_length, child2->current_count);
+			j++;
+			more2 = read_from_child(child2);
+		}
+	}
+
+	while(more1){
+		write_string(child1->current, child1->current_length, child1->current_count);
+		i++;
+		more1 = read_from_child(child1);
+	}
+
+	while(more2){
+		write_string(child2->current, child2->current_length, child2->current_count);
+		j++;
+		more2 = read_from_child(child2);
+	}
+
+	//with -c a child returns fewer strings if it found duplicates
+	if(i>sub_strings1_size || j>sub_strings2_size || (!count_mode && (i<sub_strings1_size || j<sub_strings2_size))){
+		bail_out(EXIT_FAILURE, "children returned %ld and %ld instead of %ld and %ld strings", i, j, sub_strings1_size, 
+			sub_strings2_size);
+	}
+
+	if(!shared_results){
+		(void) fclose(child1->output);
+		(void) fclose(child2->output);
+	}
+	child1->output = NULL;
+	child2->output = NULL;
+	child1->read_fd = -1;
+	child2->read_fd = -1;
+	//the merge includes the time spent reading, which is also traced on its own
+	trace("readback", start, readback_time);
+	trace("merge", start, trace_clock()-start);
+}
+
+static int read_from_child(struct child *child){
 
-/** 
- * fd4[0] is used by the parent to read from the redirected stdout of the second child;
- * fd4[1] is used by the second child to write (redirected stdout) 
- */
-static int fd4[2];
+	child->current_count = 1;
+	if(shared_results){
+		if(child->results_read == child->results_size){
+			return 0;
+		}
+		const struct string *string = &child->results[child->results_read++];
+		child->current = bytes+string->offset;
+		child->current_length = string->length;
+		return 1;
+	}
 
-/** The read strings **/
-static char** strings;
+	long long int start = trace_clock();
+	int more = 1;
+	if(index_records){
+		struct string string;
+		if(count_mode && fread(&child->current_count, sizeof(long int), 1, child->output) != 1){
+			more = 0;
+		}
+		else if(fread(&string, sizeof(struct string), 1, child->output) != 1){
+			if(count_mode){
+				bail_out(EXIT_FAILURE, "child %ld returned a truncated string", (long int) child->pid);
+			}
+			more = 0;
+		}
+		else if(string.offset > bytes_size || string.length > bytes_size-string.offset){
+			bail_out(EXIT_FAILURE, "child %ld returned an invalid string", (long int) child->pid);
+		}
+		else{
+			child->current = bytes+string.offset;
+			child->current_length = string.length;
+		}
+	}
+	else{
+		more = read_record(child->output, &child->buffer, &child->buffer_capacity, &child->current_length, 
+			&child->current_count);
+		child->current = child->buffer;
+	}
+	if(!more && ferror(child->output)){
+		bail_out(EXIT_FAILURE, "reading from child %ld", (long int) child->pid);
+	}
+	readback_time += trace_clock()-start;
+	return more;
+}
 
-/** The first half of the read strings **/
-static char** sub_strings1;
+static void write_string(const char *string, size_t length, long int count){
 
-/** The second half of the read strings **/
-static char **sub_strings2;
+	if(results != NULL){
+		results[results_size].offset = string-bytes;
+		results[results_size].length = length;
+		results_size++;
+	}
+	else if(record_mode && index_records){
+		//the parent has the same bytes, so the position of the string is enough
+		if(count_mode){
+			output_append(&count, sizeof(long int));
+		}
+		struct string index;
+		index.offset = string-bytes;
+		index.length = length;
+		output_append(&index, sizeof(struct string));
+	}
+	else if(record_mode){
+		if(count_mode){
+			output_append(&count, sizeof(long int));
+		}
+		uint32_t record_length = length;
+		output_append(&record_length, RECORD_HEADER_SIZE);
+		output_append(string, length);
+	}
+	else{
+		if(count_mode){
+			char count_str[MAX_LENGTH];
+			int count_length = sprintf(count_str, "%*ld ", COUNT_WIDTH, count);
+			output_append(count_str, count_length);
+		}
+		output_append(string, length);
+		output_append("\n", 1);
+	}
+}
 
-/* === Prototypes === */
+static void output_append(const void *data, size_t length){
 
-/**
- * @brief Forks the process and redirects stdin and stdout of the first child to file descriptors.
- * @param strings The entire list of strings
- * @param sub_strings1 The first of half of the entire list of strings which is written to the pipe from which the first child reads
- * @param strings_size The size of the entire list of strings
- * @details The forked child will use redirected stdin and stdout and recall the forksort program from the beginning. 
- * The parent will write through a pipe the first half of the entire list of strings and will wait until the child has sorted it. 
- * After the child has finished the parent will read through another pipe the result and will store it to sub_strings1.
- */
-static void forked_child1(char **strings, char **sub_strings1, long int strings_size);
+	if(output_size+length <= OUTPUT_BUFFER_SIZE){
+		(void) memcpy(output+output_size, data, length);
+		output_size += length;
+		return;
+	}
+	struct iovec iov[2];
+	iov[0].iov_base = output;
+	iov[0].iov_len = output_size;
+	iov[1].iov_base = (void *) data;
+	iov[1].iov_len = length;
+	output_size = 0;
+	write_all(fileno(stdout), iov, 2);
+}
 
-/**
- * @brief Forks the process and redirects stdin and stdout of the second child to file descriptors.
- * @param strings The entire list of strings
- * @param sub_strings2 The second of half of the entire list of strings which is written to the pipe from which the second child reads
- * @param strings_size The size of the entire list of strings
- * @details The forked child will use redirected stdin and stdout and recall the forksort program from the beginning. 
- * The parent will write through a pipe the second half of the entire list of strings and will wait until the child has sorted it. 
- * After the child has finished the parent will read through another pipe the result and will store it to sub_strings2.
- */
-static void forked_child2(char **strings, char **sub_strings2, long int strings_size);
+static void output_flush(void){
 
-/**
- * @brief Performs the mergesort algorithm on 2 given arrays of strings.
- * @param sub_strings1 the first array of strings
- * @param sub_strings1_size the number of elements of the first array
- * @param sub_strings2 the second array of strings
- * @param sub_strings2_size the number of elements of the second array
- * @details The two given arrays are merged, sorted and printed out to the stream using filedescriptor number 1
- */
-static void merge_sort(char **sub_strings1, long int sub_strings1_size, char **sub_strings2, long int sub_strings2_size);
+	struct iovec iov;
+	iov.iov_base = output;
+	iov.iov_len = output_size;
+	output_size = 0;
+	write_all(fileno(stdout), &iov, 1);
+}
 
-/**
- * @brief terminate program on program error
- * @param exitcode exit code
- * @param fmt format string
- */
-static void bail_out(int exitcode, const char *fmt, ...);
+static void write_all(int fd, struct iovec *iov, int iovcnt){
 
-/**
- * @brief free allocated resources
- */
-static void free_resources(void);
+	while(iovcnt > 0){
+		if(iov->iov_len == 0){
+			iov++;
+			iovcnt--;
+			continue;
+		}
+		ssize_t written = writev(fd, iov, iovcnt);
+		if(written<0){
+			if(errno == EINTR){
+				errno = 0;
+				continue;
+			}
+			bail_out(EXIT_FAILURE, "writev");
+		}
+		//skip the completely written buffers and advance into the partially written one
+		while(iovcnt > 0 && (size_t) written >= iov->iov_len){
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if(iovcnt > 0){
+			iov->iov_base = (char *) iov->iov_base+written;
+			iov->iov_len -= written;
+		}
+	}
+}
 
-/* === Implementations === */
+static int compare_lines(const char *string1, size_t length1, const char *string2, size_t length2){
 
-/**
- * @brief Program entry point
- * @param argc The argument counter
- * @param argv The argument vector
- * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
- * @details Parses the number of strings and reads the strings
- */
-int main(int argc, char **argv){
+	if(!custom_order){
+		return compare_bytes(string1, length1, string2, length2);
+	}
+	size_t key_length1;
+	size_t key_length2;
+	const char *key1 = find_key(string1, length1, &key_length1);
+	const char *key2 = find_key(string2, length2, &key_length2);
+	int result;
+	if(numeric_order){
+		double number1 = key_number(key1, key_length1);
+		double number2 = key_number(key2, key_length2);
+		result = (number1 > number2) - (number1 < number2);
+	}
+	else{
+		result = compare_bytes(key1, key_length1, key2, key_length2);
+	}
+	if(result == 0 && !count_mode){
+		result = compare_bytes(string1, length1, string2, length2);
+	}
+	return reverse_order ? -result : result;
+}
 
-	progname = argv[0];
+static const char *find_key(const char *string, size_t length, size_t *key_length){
 
-	//check program has only 1 argument
-	if(argc != 1){
-		bail_out(EXIT_FAILURE,"Usage: %s", progname);
+	if(key_field == 0){
+		*key_length = length;
+		return string;
 	}
-	//parse the number of strings
-	char num_of_elements_str[MAX_LENGTH];
-	if((fgets(num_of_elements_str, MAX_LENGTH, stdin))==NULL){
-		bail_out(EXIT_FAILURE, "fgets");
+	const char *position = string;
+	const char *end = string+length;
+	for(long int field=1; ; field++){
+		if(key_delimiter < 0){
+			//the blanks in front of a field are skipped
+			while(position < end && (*position == ' ' || *position == '\t')){
+				position++;
+			}
+		}
+		const char *field_end = position;
+		if(key_delimiter < 0){
+			while(field_end < end && *field_end != ' ' && *field_end != '\t'){
+				field_end++;
+			}
+		}
+		else{
+			field_end = memchr(position, key_delimiter, end-position);
+			if(field_end == NULL){
+				field_end = end;
+			}
+		}
+		if(field == key_field){
+			*key_length = field_end-position;
+			return position;
+		}
+		if(field_end == end){
+			*key_length = 0;
+			return end;
+		}
+		position = (key_delimiter < 0) ? field_end : field_end+1;
 	}
-	
-	char *endptr;
-	long int num_of_elements = strtol(num_of_elements_str ,&endptr, 10);
+}
 
-	if((errno == ERANGE && (num_of_elements == LONG_MAX || num_of_elements == LONG_MIN)) || errno != 0){
-		bail_out(EXIT_FAILURE, "strtol");
+static double key_number(const char *key, size_t length){
+
+	const char *position = key;
+	const char *end = key+length;
+	while(position < end && (*position == ' ' || *position == '\t')){
+		position++;
+	}
+	int negative = (position < end && *position == '-');
+	if(negative){
+		position++;
+	}
+	double number = 0;
+	while(position < end && *position >= '0' && *position <= '9'){
+		number = number*10 + (*position-'0');
+		position++;
+	}
+	if(position < end && *position == '.'){
+		double scale = 1;
+		for(position++; position < end && *position >= '0' && *position <= '9'; position++){
+			scale /= 10;
+			number += (*position-'0')*scale;
+		}
 	}
+	return negative ? -number : number;
+}
 
-	if (endptr == num_of_elements_str){
-		bail_out(EXIT_FAILURE, "No digits were found");
+static long int count_equal(const struct string *strings, long int strings_size){
+
+	long int count = 1;
+	while(count_mode && count < strings_size && compare_strings(&strings[0], &strings[count]) == 0){
+		count++;
 	}
+	return count;
+}
 
-	if(*endptr != '\n'){
-		bail_out(EXIT_FAILURE, "Further characters after number found: %s", endptr);
+static int compare_bytes(const char *string1, size_t length1, const char *string2, size_t length2){
+
+	int result = memcmp(string1, string2, length1 < length2 ? length1 : length2);
+	if(result != 0){
+		return result;
 	}
+	return (length1 > length2) - (length1 < length2);
+}
 
-	if(num_of_elements<1){
-		bail_out(EXIT_FAILURE, "Number of elements has to be greater than 0");
+static void leaf_sort(struct string *strings, long int strings_size){
+
+	sort_in_memory(strings, strings_size);
+	for(long int i=0; i<strings_size; ){
+		long int count = count_equal(strings+i, strings_size-i);
+		write_string(bytes+strings[i].offset, strings[i].length, count);
+		i += count;
 	}
+}
 
-	//read the strings
-	strings = malloc(num_of_elements * sizeof(char*));
-	if(strings == NULL){
-		bail_out(EXIT_FAILURE, "malloc");
+static void sort_in_memory(struct string *strings, long int strings_size){
+
+	long long int start = trace_clock();
+	if(engine == QUICK){
+		multikey_quicksort(strings, strings_size, 0);
 	}
-	long int count = 0;
-	while(count<num_of_elements){
-		strings[count] = malloc(MAX_LENGTH * sizeof(char));
-		if(strings[count] == NULL){
+	else{
+		struct string *buffer = malloc(strings_size*sizeof(struct string));
+		if(buffer == NULL){
 			bail_out(EXIT_FAILURE, "malloc");
 		}
-		if(fgets(strings[count], MAX_LENGTH, stdin)==NULL){
-			bail_out(EXIT_FAILURE, "fgets");
+		if(engine == RADIX){
+			radix_sort(strings, strings_size, 0, buffer);
 		}
-		count++;
+		else{
+			merge_sort_strings(strings, strings_size, buffer);
+		}
+		free(buffer);
 	}
+	trace("sort", start, trace_clock()-start);
+}
 
-	if(num_of_elements == 1){
-		(void) fprintf(stdout, "%s", strings[0]);
+static void merge_sort_strings(struct string *strings, long int strings_size, struct string *buffer){
+
+	if(strings_size < INSERTION_SORT_THRESHOLD){
+		insertion_sort(strings, strings_size, 0);
+		return;
 	}
-	else{
-		//create 4 unnamed pipes for reading and writing
-		if(pipe(fd1)<0 || pipe(fd2)<0 || pipe(fd3)<0 || pipe(fd4)<0){
-			bail_out(EXIT_FAILURE, "pipe");
+	long int half = strings_size/2;
+	merge_sort_strings(strings, half, buffer);
+	merge_sort_strings(strings+half, strings_size-half, buffer);
+
+	//the halves are already in order, nothing to merge
+	if(compare_strings(&strings[half-1], &strings[half]) <= 0){
+		return;
+	}
+	(void) memcpy(buffer, strings, strings_size*sizeof(struct string));
+	long int i = 0;
+	long int j = half;
+	long int k = 0;
+	while(i<half && j<strings_size){
+		if(compare_strings(&buffer[j], &buffer[i])<0){
+			strings[k++] = buffer[j++];
 		}
-		sub_strings1 = malloc((num_of_elements/2)*sizeof(char*));
-		sub_strings2 = malloc((num_of_elements-num_of_elements/2)*sizeof(char*));
-		if(sub_strings1 == NULL || sub_strings2 == NULL){
-			bail_out(EXIT_FAILURE, "malloc");
+		else{
+			strings[k++] = buffer[i++];
 		}
-
-		//fork
-		forked_child1(strings, sub_strings1, num_of_elements);
-		forked_child2(strings, sub_strings2, num_of_elements);
-		
-		//merge the results
-		merge_sort(sub_strings1, num_of_elements/2, sub_strings2, num_of_elements-num_of_elements/2);
 	}
-	
-	free_resources();
-	return EXIT_SUCCESS;
+	while(i<half){
+		strings[k++] = buffer[i++];
+	}
+	while(j<strings_size){
+		strings[k++] = buffer[j++];
+	}
 }
 
-static void forked_child1(char **strings, char **sub_strings1, long int strings_size){
+static void multikey_quicksort(struct string *strings, long int strings_size, size_t depth){
 
-	long int sub_strings1_size = strings_size/2;
-	pid_t pid = fork();
+	while(strings_size >= INSERTION_SORT_THRESHOLD){
+		//median of three as pivot byte
+		int a = byte_at(&strings[0], depth);
+		int b = byte_at(&strings[strings_size/2], depth);
+		int c = byte_at(&strings[strings_size-1], depth);
+		int pivot = (a<b) ? ((b<c) ? b : ((a<c) ? c : a)) : ((a<c) ? a : ((b<c) ? c : b));
 
-	if(pid==0){
-		//redirect stdin and stdout to the file descriptors
-		if(dup2(fd1[0], fileno(stdin))<0){
-			bail_out(EXIT_FAILURE, "dup2");
-		}
-		if(dup2(fd2[1], fileno(stdout))<0){
-			bail_out(EXIT_FAILURE, "dup2");
-		}
-		//close unused endpoints
-		(void) close(fd1[0]);
-		(void) close(fd1[1]);
-		(void) close(fd2[0]);
-		(void) close(fd2[1]);
-		if(execlp("./forksort", "forksort", NULL)<0){
-			bail_out(EXIT_FAILURE, "execlp");
-		}
-	}
-	else if(pid>0){
-		//close unused endpoints
-		(void) close(fd1[0]);
-		(void) close(fd2[1]);
-		
-		//write number of sub_strings1 to the redirected stdin of child1
-		char number[MAX_LENGTH];
-		(void) sprintf(number, "%li\n", sub_strings1_size);
-		if(write(fd1[1], number, strlen(number))<0){
-			bail_out(EXIT_FAILURE, "write");
-		}
-		
-		//now write half of the data to the redirected stdin of child1
-		for(long int i=0; i<sub_strings1_size; i++){
-			if(write(fd1[1], strings[i], strlen(strings[i]))<0){
-				bail_out(EXIT_FAILURE, "write");
+		//three-way partitioning: [0, lt) smaller, [lt, gt] equal, (gt, strings_size) greater
+		long int lt = 0;
+		long int gt = strings_size-1;
+		long int i = 0;
+		while(i <= gt){
+			int byte = byte_at(&strings[i], depth);
+			if(byte < pivot){
+				struct string tmp = strings[lt];
+				strings[lt++] = strings[i];
+				strings[i++] = tmp;
 			}
-		}
-		(void) close(fd1[1]);
-		
-		//wait until child1 finished
-		int status;
-		pid_t wpid;
-		while((wpid = wait(&status)) != pid){
-        	if(wpid != -1){
-				continue;
-        	}
-			if(errno == EINTR){
-				continue;
+			else if(byte > pivot){
+				struct string tmp = strings[gt];
+				strings[gt--] = strings[i];
+				strings[i] = tmp;
+			}
+			else{
+				i++;
 			}
 		}
 
-		//at this point, child1 finished work. now get from its stdout the data
-		FILE *file = fdopen(fd2[0], "r");
-		if(file == NULL){
-			bail_out(EXIT_FAILURE, "fdopen");
+		multikey_quicksort(strings, lt, depth);
+		multikey_quicksort(strings+gt+1, strings_size-gt-1, depth);
+
+		//the equal part continues with the next byte, unless all of its strings ended here and are equal
+		if(pivot < 0){
+			return;
 		}
-		long int count = 0;
-		while(count<sub_strings1_size){
-			sub_strings1[count] = malloc(MAX_LENGTH*sizeof(char));
-			if(sub_strings1[count] == NULL){
-				bail_out(EXIT_FAILURE, "malloc");
-			}
-			if(fgets(sub_strings1[count], MAX_LENGTH, file) == NULL){
-				bail_out(EXIT_FAILURE, "fgets");
-			}
-			count++;
+		int partitioned = (lt > 0 || gt < strings_size-1);
+		strings += lt;
+		strings_size = gt-lt+1;
+		depth++;
+		if(!partitioned){
+			//the strings probably share a longer prefix
+			depth += common_prefix(strings, strings_size, depth);
 		}
-		(void) fclose(file);
-		(void) close(fd2[0]);
-		
-	}
-	else{
-		bail_out(EXIT_FAILURE, "fork");
 	}
+	insertion_sort(strings, strings_size, depth);
 }
 
-static void forked_child2(char **strings, char **sub_strings2, long int strings_size){
+static void radix_sort(struct string *strings, long int strings_size, size_t depth, struct string *buffer){
 
-	long int sub_strings2_size = strings_size-strings_size/2;
-	pid_t pid = fork();
+	long int count[RADIX_BUCKETS];
+	long int position[RADIX_BUCKETS];
 
-	if(pid==0){
-		//redirect stdin and stdout to the file descriptors
-		if(dup2(fd3[0], fileno(stdin))<0){
-			bail_out(EXIT_FAILURE, "dup2");
+	//every distribution takes one bucket and adds at most RADIX_BUCKETS-1 new ones
+	struct radix_bucket *stack = NULL;
+	long int stack_size = 0;
+	long int stack_capacity = 0;
+	struct radix_bucket bucket = {0, strings_size, depth};
+	while(1){
+		struct string *part = strings+bucket.start;
+		if(bucket.size < RADIX_SORT_THRESHOLD){
+			multikey_quicksort(part, bucket.size, bucket.depth);
 		}
-		if(dup2(fd4[1], fileno(stdout))<0){
-			bail_out(EXIT_FAILURE, "dup2");
+		else{
+			(void) memset(count, 0, sizeof(count));
+			for(long int i=0; i<bucket.size; i++){
+				count[byte_at(&part[i], bucket.depth)+1]++;
+			}
+
+			//skip a prefix which is equal for all strings without distributing them
+			int first = byte_at(&part[0], bucket.depth)+1;
+			if(count[first] == bucket.size){
+				if(first != 0){
+					bucket.depth++;
+					bucket.depth += common_prefix(part, bucket.size, bucket.depth);
+					continue;
+				}
+			}
+			else{
+				position[0] = 0;
+				for(int b=1; b<RADIX_BUCKETS; b++){
+					position[b] = position[b-1]+count[b-1];
+				}
+				for(long int i=0; i<bucket.size; i++){
+					buffer[position[byte_at(&part[i], bucket.depth)+1]++] = part[i];
+				}
+				(void) memcpy(part, buffer, bucket.size*sizeof(struct string));
+
+				if(stack_size+RADIX_BUCKETS > stack_capacity){
+					stack_capacity = stack_capacity*2 + RADIX_BUCKETS;
+					struct radix_bucket *grown = realloc(stack, stack_capacity*sizeof(struct radix_bucket));
+					if(grown == NULL){
+						free(stack);
+						bail_out(EXIT_FAILURE, "realloc");
+					}
+					stack = grown;
+				}
+
+				//the strings in bucket 0 ended before depth and are equal
+				long int start = bucket.start+bucket.size;
+				for(int b=RADIX_BUCKETS-1; b>=1; b--){
+					start -= count[b];
+					if(count[b] > 1){
+						stack[stack_size].start = start;
+						stack[stack_size].size = count[b];
+						stack[stack_size].depth = bucket.depth+1;
+						stack_size++;
+					}
+				}
+			}
 		}
-		//close unused endpoints
-		(void) close(fd3[0]);
-		(void) close(fd3[1]);
-		(void) close(fd4[0]);
-		(void) close(fd4[1]);
-		if(execlp("./forksort", "forksort", NULL)<0){
-			bail_out(EXIT_FAILURE, "execlp");
+		if(stack_size == 0){
+			break;
 		}
+		bucket = stack[--stack_size];
 	}
-	else if(pid>0){
-		(void) close(fd3[0]);
-		(void) close(fd4[1]);
-		
-		//write number of sub_strings2 to the redirected stdin of child2
-		char number[MAX_LENGTH];
-		(void) sprintf(number, "%li\n", sub_strings2_size);
-		if(write(fd3[1], number, strlen(number))<0){
-			bail_out(EXIT_FAILURE, "write");
-		}
-		
-		//now write half of the data to the redirected stdin of child2
-		for(long int i=strings_size/2; i<strings_size; i++){
-			if(write(fd3[1], strings[i], strlen(strings[i]))<0){
-				bail_out(EXIT_FAILURE, "write");
-			}
-		}
-		(void) close(fd3[1]);
-		
-		//wait until child2 finished
-		int status;
-		pid_t wpid;
-		while((wpid = wait(&status)) != pid){
-        	if(wpid != -1){
-				continue;
-        	}
-			if(errno == EINTR){
-				continue;
-			}
+	free(stack);
+}
+
+static void insertion_sort(struct string *strings, long int strings_size, size_t depth){
+
+	for(long int i=1; i<strings_size; i++){
+		struct string string = strings[i];
+		long int j = i;
+		//the first depth bytes are equal, so only the rest is compared
+		while(j>0 && compare_lines(bytes+strings[j-1].offset+depth, strings[j-1].length-depth, 
+				bytes+string.offset+depth, string.length-depth) > 0){
+			strings[j] = strings[j-1];
+			j--;
 		}
+		strings[j] = string;
+	}
+}
 
-		//at this point, child2 finished work. now get from its stdout the data
-		FILE *file = fdopen(fd4[0], "r");
-		if(file == NULL){
-			bail_out(EXIT_FAILURE, "fdopen");
+static size_t common_prefix(const struct string *strings, long int strings_size, size_t depth){
+
+	const char *first = bytes+strings[0].offset+depth;
+	size_t prefix = strings[0].length-depth;
+	for(long int i=1; i<strings_size && prefix>0; i++){
+		const char *string = bytes+strings[i].offset+depth;
+		size_t length = strings[i].length-depth;
+		if(length < prefix){
+			prefix = length;
 		}
-		long int count = 0;
-		while(count<sub_strings2_size){
-			sub_strings2[count] = malloc(MAX_LENGTH*sizeof(char));
-			if(sub_strings2[count] == NULL){
-				bail_out(EXIT_FAILURE, "malloc");
-			}
-			if(fgets(sub_strings2[count], MAX_LENGTH, file) == NULL){
-				bail_out(EXIT_FAILURE, "fgets");
-			}
-			count++;
+		size_t j = 0;
+		while(j<prefix && first[j] == string[j]){
+			j++;
 		}
-		(void) fclose(file);
-		(void) close(fd4[0]);
-		
+		prefix = j;
 	}
-	else{
-		bail_out(EXIT_FAILURE, "fork");
+	return prefix;
+}
+
+static int byte_at(const struct string *string, size_t depth){
+
+	if(depth < string->length){
+		return (unsigned char) bytes[string->offset+depth];
 	}
+	return -1;
 }
 
+static int compare_strings(const void *a, const void *b){
 
-static void merge_sort(char **sub_strings1, long int sub_strings1_size, char **sub_strings2, long int sub_strings2_size){
+	const struct string *string1 = a;
+	const struct string *string2 = b;
+	return compare_lines(bytes+string1->offset, string1->length, bytes+string2->offset, string2->length);
+}
 
-	int i = 0;
-	int j = 0;
+static void arena_reserve(size_t bytes){
 
-	while(i<sub_strings1_size && j<sub_strings2_size){
-		if(strcmp(sub_strings1[i], sub_strings2[j])<0){
-			(void) fprintf(stdout, sub_strings1[i]);
-			i++;
+	if(arena.capacity-arena.size >= bytes){
+		return;
+	}
+	size_t capacity = arena.capacity*2 + ARENA_CHUNK;
+	if(memory_budget > 0 && capacity > memory_budget){
+		//with -m the arena never grows beyond the budget, unless a single string is larger
+		capacity = memory_budget;
+	}
+	if(capacity-arena.size < bytes){
+		capacity = arena.size + bytes;
+	}
+	char *data = realloc(arena.data, capacity);
+	if(data == NULL){
+		bail_out(EXIT_FAILURE, "realloc");
+	}
+	arena.data = data;
+	arena.capacity = capacity;
+}
+
+static int read_string(FILE *input, struct string *string){
+
+	size_t record = arena.size;
+	string->offset = record+RECORD_HEADER_SIZE;
+
+	if(record_mode){
+		uint32_t length;
+		if(fread(&length, RECORD_HEADER_SIZE, 1, input) != 1){
+			return 0;
 		}
-		else{
-			(void) fprintf(stdout, sub_strings2[j]);
-			j++;
+		arena_reserve(RECORD_HEADER_SIZE+length);
+		if(length > 0 && fread(arena.data+string->offset, length, 1, input) != 1){
+			bail_out(EXIT_FAILURE, "fread");
+		}
+		string->length = length;
+	}
+	else{
+		//read the line in pieces until its newline or the end of the input is reached
+		size_t end = string->offset;
+		while(1){
+			arena_reserve(end-arena.size+MAX_LENGTH);
+			size_t available = arena.capacity-end;
+			if(fgets(arena.data+end, available > INT_MAX ? INT_MAX : (int) available, input)==NULL){
+				if(end == string->offset){
+					return 0;
+				}
+				break;
+			}
+			end += strlen(arena.data+end);
+			if(arena.data[end-1] == '\n'){
+				end--;
+				break;
+			}
+		}
+		if(end-string->offset > UINT32_MAX){
+			bail_out(EXIT_FAILURE, "String too long");
 		}
+		string->length = end-string->offset;
 	}
 
-	while(i<sub_strings1_size){
-		(void) fprintf(stdout, sub_strings1[i]);
-		i++;
+	uint32_t length = string->length;
+	(void) memcpy(arena.data+record, &length, RECORD_HEADER_SIZE);
+	arena.size = string->offset+string->length;
+	return 1;
+}
+
+static void exec_forksort(long int child_workers, struct string *strings, long int strings_size){
+
+	char workers_str[MAX_LENGTH];
+	char begin_str[MAX_LENGTH];
+	char end_str[MAX_LENGTH];
+	char depth_str[MAX_LENGTH];
+	char key_field_str[MAX_LENGTH];
+	char key_delimiter_str[2];
+	const char *engines[] = {"merge", "quick", "radix"};
+	char *args[25];
+	int count = 0;
+
+	args[count++] = "forksort";
+	args[count++] = "-R";
+	args[count++] = "-a";
+	args[count++] = (char *) engines[engine];
+	if(workers != UNBOUNDED_WORKERS){
+		(void) sprintf(workers_str, "%li", child_workers);
+		args[count++] = "-j";
+		args[count++] = workers_str;
+	}
+	if(input_file != NULL){
+		//the strings of the child are the lines between the first and the last of its strings, including the newline
+		//of the last one, so a range never is empty even if it consists of an empty line
+		(void) sprintf(begin_str, "%lu", (unsigned long int) strings[0].offset);
+		(void) sprintf(end_str, "%lu", (unsigned long int) (strings[strings_size-1].offset+strings[strings_size-1].length+1));
+		args[count++] = "-f";
+		args[count++] = (char *) input_file;
+		args[count++] = "-B";
+		args[count++] = begin_str;
+		args[count++] = "-E";
+		args[count++] = end_str;
 	}
+	if(key_field != 0){
+		(void) sprintf(key_field_str, "%li", key_field);
+		args[count++] = "-k";
+		args[count++] = key_field_str;
+	}
+	if(key_delimiter >= 0){
+		key_delimiter_str[0] = key_delimiter;
+		key_delimiter_str[1] = '\0';
+		args[count++] = "-t";
+		args[count++] = key_delimiter_str;
+	}
+	if(numeric_order){
+		args[count++] = "-n";
+	}
+	if(reverse_order){
+		args[count++] = "-r";
+	}
+	if(count_mode){
+		args[count++] = "-c";
+	}
+	if(trace_file != NULL){
+		(void) sprintf(depth_str, "%li", depth);
+		args[count++] = "-T";
+		args[count++] = (char *) trace_file;
+		args[count++] = "-D";
+		args[count++] = depth_str;
+	}
+	args[count] = NULL;
 
-	while(j<sub_strings2_size){
-		(void) fprintf(stdout, sub_strings2[j]);
-		j++;
+	if(execvp("./forksort", args)<0){
+		bail_out(EXIT_FAILURE, "execvp");
 	}
 }
 
@@ -398,9 +2522,40 @@ static void bail_out(int exitcode, const char *fmt, ...){
 
 static void free_resources(void){
 
+	if(trace_fd>=0){
+		trace("process", process_start, trace_clock()-process_start);
+		(void) close(trace_fd);
+		trace_fd = -1;
+	}
 	free(strings);
-	free(sub_strings1);
-	free(sub_strings2);
+	free(arena.data);
+	free(child1.buffer);
+	free(child2.buffer);
+	if(mapping != MAP_FAILED){
+		(void) munmap(mapping, mapping_size);
+	}
+	if(shared_region != MAP_FAILED){
+		(void) munmap(shared_region, shared_region_size);
+	}
+	if(child1.output != NULL){
+		(void) fclose(child1.output);
+	}
+	if(child2.output != NULL){
+		(void) fclose(child2.output);
+	}
+	for(int i=0; i<runs_size; i++){
+		if(runs[i].file != NULL){
+			(void) fclose(runs[i].file);
+		}
+		free(runs[i].current);
+	}
+	for(long int i=0; i<partitions_size; i++){
+		if(partitions[i].output != NULL){
+			(void) fclose(partitions[i].output);
+		}
+		free(partitions[i].buffer);
+	}
+	free(partitions);
 	(void) close(fd1[0]);
 	(void) close(fd1[1]);
 	(void) close(fd2[0]);